@@ -30,6 +30,7 @@
 #define _STABLE_API_H_
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <string.h>
 #include <stdio.h>
 
@@ -39,6 +40,7 @@
 #include <gsl/gsl_vector.h>
 
 #include "opencl_integ.h"
+#include "stable_series.h"
 
 #define TINY 1e-50
 #define EPS 2.2204460492503131E-16
@@ -54,6 +56,7 @@ extern FILE * FLOG;            // Log file (optional)
 extern FILE * FINTEG;          // Integrand evaluations output file (debug purposes)
 
 extern unsigned short THREADS;    // threads of execution (0 => total available)
+extern unsigned int CHUNK_SIZE;   // points taken at once by each thread (0 => automatic)
 extern unsigned short IT_MAX;     // Maximum # of iterations in quadrature methods
 extern unsigned short SUBS;       // # of integration subintervals
 extern unsigned short METHOD;     // Integration method on main subinterval
@@ -72,8 +75,7 @@ extern double EXP_MAX;    // Exponent maximum value
 extern double XXI_TH;     // Zeta threshold
 extern double THETA_TH;   // Theta threshold
 
-extern double AUX1; // Auxiliary values
-extern double AUX2;
+extern unsigned short EVAL_MODE; // Alternatives to the numerical integration
 
 #ifdef DEBUG
 extern unsigned int integ_eval; // # of integrand evaluations
@@ -109,7 +111,22 @@ enum {
 	STABLE_QAG1,
 	STABLE_QAG5,
 	STABLE_VECT,
-	STABLE_OCL
+	STABLE_OCL,
+	STABLE_GK21  // In-library adaptive 21 point Gauss-Kronrod on node kernels
+};
+
+// Quasi-random generation modes (flags of stable_rnd_qmc)
+enum {
+	STABLE_QMC_CMS = 0,      // Variate transform of 2D Sobol points, as stable_rnd
+	STABLE_QMC_INV = 1,      // Quantiles of 1D Sobol points, with stable_inv
+	STABLE_QMC_SCRAMBLE = 2  // Random linear scrambling and digital shift of each stream
+};
+
+// Evaluation modes (flags of EVAL_MODE)
+enum {
+	STABLE_EVAL_INTEG = 0,  // Numerical integration at every point
+	STABLE_EVAL_TAILS = 1,  // Tail expansions where they reach relTOL
+	STABLE_EVAL_CENTER = 2  // Power series around xi where it reaches relTOL
 };
 
 
@@ -122,6 +139,36 @@ enum {
    single evaluation of the desired function, at a single point.
 */
 
+/******************************************************************************/
+/*    Configuration of the numerical methods.                                 */
+/******************************************************************************/
+/* Fields have the same meaning as the library parameters above. Distributions
+   with a configuration of their own use it instead of the global parameters,
+   so several precision profiles can be evaluated at the same time. */
+
+#define STABLE_FIT_EPSABS 0.008  // Default size tolerance of the fit simplex
+#define STABLE_FIT_MAXITER 300   // Default maximum # of iterations in fitting
+#define STABLE_FIT_BINS 0        // Default # of bins of the likelihood (0: every sample)
+#define STABLE_FIT_STARTS 1      // Default # of parallel starts of the fit simplex
+
+struct stable_config {
+	unsigned short THREADS;
+	unsigned short IT_MAX;
+	unsigned short METHOD;
+	unsigned short METHOD2;
+	unsigned short METHOD3;
+	unsigned short INV_MAXITER;
+	double relTOL;
+	double absTOL;
+	double XXI_TH;
+	double THETA_TH;
+	unsigned short EVAL_MODE;
+	double FIT_EPSABS;
+	unsigned short FIT_MAXITER;
+	unsigned int FIT_BINS;
+	unsigned short FIT_STARTS;
+};
+
 /******************************************************************************/
 /*    Stable distribution structure.                                          */
 /******************************************************************************/
@@ -144,8 +191,12 @@ struct StableDistStruct {
 	int ZONE;
 
 	/* Pointers to pdf and cdf evaluation functions */
-	double(*stable_pdf_point)(struct StableDistStruct *, const double, double *);
-	double(*stable_cdf_point)(struct StableDistStruct *, const double, double *);
+	double(*stable_pdf_point)(const struct StableDistStruct *, const double, double *);
+	double(*stable_cdf_point)(const struct StableDistStruct *, const double, double *);
+
+	/* Transform of the uniforms of stable_rnd into variates */
+	void(*stable_rnd_transform)(const struct StableDistStruct *, const double[],
+								const double[], double[], int);
 
 	/* Precalculated values. */
 	double alfainvalfa1;  /* alfa/(alfa-1)*/
@@ -157,17 +208,29 @@ struct StableDistStruct {
 	double Vbeta1; /*pow(1/dist->alfa,dist->alfainvalfa1) *
                      (dist->alfa-1)*pow(-cos(dist->alfa*PI_2),1/(dist->alfa-1))*/
 
-	/* These ones change from point to point of evaluation */
-	double theta0_; /* theta0_ = +-theta0 */
-	double beta_;
-	double xxipow;  /* (x-xi)^(alfa/(alfa-1))*/
+	/* Tail expansions of the PDF and CDF, indexed by CDF/PDF and by right (0)
+	   or left (1) tail */
+	struct stable_tail_series tail[2][2];
 
-	/* gsl integration workspace */
-	gsl_integration_workspace * gslworkspace;
+	/* Power series of the PDF and CDF around xi, indexed by CDF/PDF */
+	struct stable_center_series center[2];
 
-	/* gsl random numbers generator */
+	/* gsl random numbers generator, which seeds the one of the GPU */
 	gsl_rng * gslrand;
 
+	/* Counter-based generator of stable_rnd: key set by stable_rnd_seed, and
+	   stream and index of the next variate */
+	uint64_t rnd_key;
+	uint64_t rnd_stream;
+	uint64_t rnd_index;
+
+	/* Own configuration, used instead of the globals when has_config is set */
+	struct stable_config config;
+	short has_config;
+
+	/* Tabulated PDF and CDF, built by stable_table_build */
+	struct stable_table *table;
+
 	struct stable_clinteg cli;
 	short gpu_enabled;
 	short parallel_gridfit;
@@ -176,12 +239,35 @@ struct StableDistStruct {
 };
 
 typedef struct StableDistStruct StableDist;
+
+/* Evaluation context. Values that change from point to point of evaluation
+   are kept here, on the stack of the caller, so the distribution itself is
+   only read and can be evaluated from several threads at once. */
+typedef struct {
+	const StableDist *dist;
+	double theta0_; /* theta0_ = +-theta0 */
+	double beta_;
+	double xxipow;  /* (x-xi)^(alfa/(alfa-1))*/
+	double aux1, aux2; /* Thresholds of log(g) delimiting the integration
+	                      subintervals, from relTOL */
+
+	/* Configuration in use for this evaluation */
+	struct stable_config cfg;
+
+	/* gsl integration workspace of the calling thread */
+	gsl_integration_workspace * gslworkspace;
+}
+StableEvalCtx;
+
 /******************************************************************************/
 /*        Auxiliary functions                                                 */
 /******************************************************************************/
 unsigned int stable_get_THREADS();
 void   stable_set_THREADS(unsigned int threads);
 
+unsigned int stable_get_CHUNK_SIZE();
+void   stable_set_CHUNK_SIZE(unsigned int chunk);
+
 unsigned int stable_get_IT_MAX();
 void   stable_set_IT_MAX(unsigned int itmax);
 
@@ -215,6 +301,9 @@ void   stable_set_XXI_TH(double xxith);
 double stable_get_THETA_TH();
 void   stable_set_THETA_TH(double thetath);
 
+int  stable_get_EVAL_MODE();
+void stable_set_EVAL_MODE(int mode);
+
 FILE * stable_get_FINTEG();
 FILE * stable_set_FINTEG(char * filename);
 
@@ -230,8 +319,16 @@ void stable_deactivate_gpu(StableDist* dist);
 
 StableDist *stable_copy(StableDist *src_dist);
 
+void stable_config_init(struct stable_config *config);
+void stable_set_config(StableDist *dist, const struct stable_config *config);
+void stable_get_config(const StableDist *dist, struct stable_config *config);
+
 void stable_free(StableDist *dist);
 
+/* Joins the worker threads used by stable_pdf, stable_cdf and stable_inv.
+   They are started again on demand. */
+void stable_pool_free();
+
 int stable_setparams(StableDist *dist,
 					 double alfa, double beta, double sigma, double mu,
 					 int parametrization);
@@ -246,21 +343,21 @@ void error_handler(const char * reason, const char * file,
 /*   PDF in particular cases                                                  */
 /******************************************************************************/
 
-double stable_pdf_point_GAUSS(StableDist *dist, const double x, double *err);
+double stable_pdf_point_GAUSS(const StableDist *dist, const double x, double *err);
 
-double stable_pdf_point_CAUCHY(StableDist *dist, const double x, double *err);
+double stable_pdf_point_CAUCHY(const StableDist *dist, const double x, double *err);
 
-double stable_pdf_point_LEVY(StableDist *dist, const double x, double *err);
+double stable_pdf_point_LEVY(const StableDist *dist, const double x, double *err);
 
 /******************************************************************************/
 /*   PDF otherwise                                                            */
 /******************************************************************************/
 
-double stable_pdf_point_STABLE(StableDist *dist, const double x, double *err);
+double stable_pdf_point_STABLE(const StableDist *dist, const double x, double *err);
 
-double stable_pdf_point_ALFA_1(StableDist *dist, const double x, double *err);
+double stable_pdf_point_ALFA_1(const StableDist *dist, const double x, double *err);
 
-double stable_pdf_point(StableDist *dist, const double x, double *err);
+double stable_pdf_point(const StableDist *dist, const double x, double *err);
 
 void stable_pdf(StableDist *dist, const double x[], const int Nx,
 				double *pdf, double *err);
@@ -268,10 +365,55 @@ void stable_pdf(StableDist *dist, const double x[], const int Nx,
 void stable_pdf_gpu(StableDist *dist, const double x[], const int Nx,
 					double *pdf, double *err);
 
+/* PDF and its derivatives with respect to alfa, beta, sigma and mu (mu_0),
+   in grad[4 * i .. 4 * i + 3] for point i. The derivatives are integrated in
+   the same pass as the PDF, differentiating its integrand; where the PDF is
+   not integrated (alfa = 1, 2, x close to xi) they come from differences. */
+void stable_pdf_grad(StableDist *dist, const double x[], const int Nx,
+					 double *pdf, double *grad);
+
 
 void stable_pcdf_gpu(StableDist *dist, const double x[], const int Nx,
 					 double *pcdf, double *cdf);
 
+/******************************************************************************/
+/*   Tabulated PDF and CDF                                                    */
+/******************************************************************************/
+/* The PDF or CDF of the distribution is interpolated from a table built once
+   by numerical integration, with a relative error under tol (relTOL of the
+   distribution when tol <= 0) on the test points of the table. Evaluation then
+   takes a constant time at any point. stable_pdf_table and stable_cdf_table
+   build the table first if it is missing or alfa or beta have changed; sigma
+   and mu_0 can change freely. Gauss, Cauchy and Levy distributions are
+   evaluated with their closed forms instead. */
+
+struct stable_table_info {
+	double tol;               // Requested relative error
+	double max_error;         // Maximum relative error on the test points
+	double build_time;        // Milliseconds spent building the table
+	size_t memory;            // Bytes taken by the table
+	unsigned int pieces;      // # of interpolation intervals
+	unsigned int evaluations; // # of points evaluated by numerical integration
+};
+
+short stable_table_build(StableDist *dist, int function, double tol);
+
+short stable_table_info(const StableDist *dist, int function,
+						struct stable_table_info *info);
+
+/* Table of the quantile function with an error of asinh(x) under tol (relTOL
+   when tol <= 0), built once for alfa and beta. While they do not change,
+   stable_rnd and the functions that share its stream draw the variates by
+   inverse transform of the first uniform of each index through the table,
+   which is faster than the general transform. */
+short stable_rnd_table_build(StableDist *dist, double tol);
+short stable_rnd_table_info(const StableDist *dist, struct stable_table_info *info);
+
+void stable_table_free(StableDist *dist);
+
+void stable_pdf_table(StableDist *dist, const double x[], const int Nx,
+					  double *pdf, double *err);
+
 /******************************************************************************/
 /*   PDF integrand functions                                                  */
 /******************************************************************************/
@@ -284,21 +426,21 @@ double stable_pdf_g_aux2(double theta, void *args);
 /*   CDF in particular cases                                                  */
 /******************************************************************************/
 
-double stable_cdf_point_GAUSS(StableDist *dist, const double x, double *err);
+double stable_cdf_point_GAUSS(const StableDist *dist, const double x, double *err);
 
-double stable_cdf_point_CAUCHY(StableDist *dist, const double x, double *err);
+double stable_cdf_point_CAUCHY(const StableDist *dist, const double x, double *err);
 
-double stable_cdf_point_LEVY(StableDist *dist, const double x, double *err);
+double stable_cdf_point_LEVY(const StableDist *dist, const double x, double *err);
 
 /******************************************************************************/
 /*   CDF otherwise                                                            */
 /******************************************************************************/
 
-double stable_cdf_point_STABLE(StableDist *dist, const double x, double *err);
+double stable_cdf_point_STABLE(const StableDist *dist, const double x, double *err);
 
-double stable_cdf_point_ALFA_1(StableDist *dist, const double x, double *err);
+double stable_cdf_point_ALFA_1(const StableDist *dist, const double x, double *err);
 
-double stable_cdf_point(StableDist *dist, const double x, double *err);
+double stable_cdf_point(const StableDist *dist, const double x, double *err);
 
 void stable_cdf(StableDist *dist, const double x[], const int Nx,
 				double *cdf, double *err);
@@ -306,6 +448,9 @@ void stable_cdf(StableDist *dist, const double x[], const int Nx,
 void stable_cdf_gpu(StableDist *dist, const double x[], const int Nx,
 					double *cdf, double *err);
 
+void stable_cdf_table(StableDist *dist, const double x[], const int Nx,
+					  double *cdf, double *err);
+
 /******************************************************************************/
 /*   CDF integrad functions                                                   */
 /******************************************************************************/
@@ -316,168 +461,70 @@ double stable_cdf_g(double theta, void *dist);
 /*   CDF^{-1} (quantiles)                                                     */
 /******************************************************************************/
 
-double stable_inv_point(StableDist * dist, const double q, double * err);
+/* Bracketed Halley iteration from the tabulated guess, with the CDF and PDF
+   of each iterate integrated together. err is the size of the last step. */
+double stable_inv_point(const StableDist * dist, const double q, double * err);
+/* Batch of quantiles solved in increasing order of q, each one from the
+   bracket and the CDF and PDF left by the previous one when that is closer
+   than the tabulated guess, which saves evaluations on dense grids */
 void   stable_inv(StableDist *dist, const double q[], const int Nq,
 				  double * inv, double * err);
 double stable_inv_point_gpu(StableDist* dist, const double q, double *err);
 short stable_inv_gpu(StableDist *dist, const double q[], const int Nq,
 					 double *inv, double *err);
 
+/* Quantiles in bulk from the tabulated CDF (built first as in
+   stable_cdf_table), with a binary search and the inversion of one
+   interpolation interval per quantile instead of a root finding on the
+   numerical integration. err gets the error of each quantile propagated from
+   the one of the table. With polish, a Newton step on the numerical CDF and PDF
+   refines all the quantiles at the cost of one integration of each. */
+void stable_inv_table(StableDist *dist, const double q[], const int Nq,
+					  double *inv, double *err, short polish);
+
 /************************************************************************
  ************************************************************************
  * Vectorial methods                                                    *
  ************************************************************************
  ************************************************************************/
 /*
-  Alternative non-parallelized methods of evaluation have been implemented.
-  These methods exploit the fact that some calculations are shared between
-  different points of evaluation when evaluating the PDF or CDF, so these
-  calculations can be realized just once.
-
-  The performance achieved is high, sometimes comparable with parallel
-  methods when little precision is required. However, achievable precision
-  with these methods is low and non desired behavior of the PDF and CDF
-  evaluation is observed.
+  Alternative method of evaluation of the PDF that exploits the fact that
+  some calculations are shared between different points of evaluation. The
+  x-independent part of the integrand, V(theta), is evaluated once on a grid
+  of Gauss-Kronrod panels reused by all the points, which are sorted so
+  consecutive ones need the grid refined at about the same places. Points are
+  shared among the threads as in stable_pdf, each one with its own grid.
+
+  The precision is the one of stable_pdf: points that do not reach relTOL on
+  the grid are evaluated with the scalar method. Other zones than the general
+  one (alfa != 1) are evaluated with stable_pdf.
 */
 
-/* Stable distribution structure for vectorial methods*/
-
-typedef struct {
-	/* Parameters:
-	    0-parametrization describen in Nolan, 1997 is employed by default
-	        alfa : stability index
-	        beta : skewness parameter
-	        scale: scale parameter
-	        mu_0 : 0-parametrization location parameter
-	        mu_1 : correspondig 1-parametrization location parameter    */
-	double alfa;
-	double beta;
-	double sigma;
-	double mu_0;
-	double mu_1;
-
-	/* Particular cases indicator (Gauss, Cauchy, Levy distribution, alfa==1, etc.) */
-	int ZONE;
-
-	/* Pointers to pdf and cdf integrand functions */
-	double *(*stable_v_pdf_g)(double, void*, double*, size_t, unsigned int, unsigned int*);
-	double *(*stable_v_cdf_g)(double, void*, double*, size_t, unsigned int, unsigned int*);
-
-	/* Precalculated values */
-	double alfainvalfa1;     /* alfa/(alfa-1)*/
-	double xi;               /* -beta*tan(alfa*pi/2)*/
-	double theta0;           /* 1/alfa*atan(beta*(tan(alfa*pi/2))=atan(-xi)/alfa;*/
-	double c1, c2_part, c3;  /* additive and multiplicative constants*/
-	double k1;               /* cos(alfa*theta0)^(1/(alfa-1)) = (1+xi^2)^(-0.5/(alfa-1));*/
-	double S;                /* (1+xi^2)^(1/(2*alfa));*/
-	double Vbeta1;           /*pow(1/dist->alfa,dist->alfainvalfa1) *
-                                   (dist->alfa-1)*pow(-cos(dist->alfa*PI_2),1/(dist->alfa-1))*/
-
-	/* These ones change from point to point of evaluation */
-	double theta0_; /* theta0_ = +-theta0 */
-	double beta_;
-	double *xxipow;  /* (x-xi)^(alfa/(alfa-1))*/
-
-	gsl_integration_workspace * gslworkspace;
-	gsl_rng * gslrand;
-}
-StableDistV;
+void stable_v_pdf(StableDist *dist, const double x[], const int Nx,
+				  double *pdf, double *err);
 
 typedef struct {
-	double (*ptr_funcion)(StableDist *dist, const double x, double *err);
+	double (*ptr_funcion)(const StableDist *dist, const double x, double *err);
 	StableDist *dist;
 	const double *x;
 	int Nx;
 	double *pdf;
 	double *err;
+	int next;  // First point not yet taken by any thread
 }
 StableArgsPdf;
 
 typedef struct {
-	double (*ptr_funcion)(StableDist *dist, const double x, double *err);
+	double (*ptr_funcion)(const StableDist *dist, const double x, double *err);
 	StableDist *dist;
 	const double *x;
 	int Nx;
 	double *cdf;
 	double *err;
+	int next;  // First point not yet taken by any thread
 }
 StableArgsCdf;
 
-unsigned int stable_v_get_THREADS();
-void   stable_v_set_THREADS(unsigned int threads);
-
-unsigned int stable_v_get_SUBS();
-void   stable_v_set_SUBS(unsigned int subs);
-
-unsigned int stable_v_get_IT_MAX();
-void   stable_v_set_IT_MAX(unsigned int itmax);
-
-int stable_v_get_METHOD();
-int stable_v_get_METHODNAME(char *s);
-void stable_v_set_METHOD(int method);
-
-FILE * stable_v_get_file_LOG();
-void stable_v_set_file_LOG(FILE * flog, char *name);
-
-double stable_v_get_absTOL();
-void   stable_v_set_absTOL(double abstol);
-
-double stable_v_get_relTOL();
-void   stable_v_set_relTOL(double reltol);
-
-double stable_v_get_ALFA_TH();
-void   stable_v_set_ALFA_TH(double alfath);
-
-double stable_v_get_BETA_TH();
-void   stable_v_set_BETA_TH(double betath);
-
-double stable_v_get_XXI_TH();
-void   stable_v_set_XXI_TH(double xxith);
-
-double stable_v_get_THETA_TH();
-void   stable_v_set_THETA_TH(double thetath);
-
-FILE * stable_v_get_FINTEG();
-FILE * stable_v_set_FINTEG(char * filename);
-
-FILE * stable_v_get_FLOG();
-FILE * stable_v_set_FLOG(char * filename);
-
-StableDistV *stable_v_create(double alfa, double beta, double sigma, double mu,
-							 int parametrization);
-
-StableDistV *stable_v_copy(StableDistV *src_dist);
-
-void stable_v_free(StableDistV *dist);
-
-int stable_v_setparams(StableDistV *dist,
-					   double alfa, double beta, double sigma, double mu,
-					   int parametrization);
-
-int stable_v_checkparams(double alfa, double beta, double sigma, double mu,
-						 int parametrization);
-
-double stable_v_pdf_point(StableDistV *dist, const double x, double *err);
-
-double stable_v_cdf_point(StableDistV *dist, const double x, double *err);
-
-double stable_v_rnd_value(StableDistV *dist);
-
-void stable_v_pdf(StableDistV *dist, const double x[], const unsigned int Nx,
-				  double *pdf, double *err);
-
-void stable_v_cdf(StableDistV *dist, const double x[], const unsigned int Nx,
-				  double *cdf, double *err);
-
-double *stable_v_rnd(StableDistV *dist, const unsigned int n);
-
-void stable_v_integration(StableDistV *dist, double(func)(double, void*),
-						  double a, double b, double epsabs, double epsrel,
-						  unsigned short limit,
-						  double *result, double *abserr, unsigned short method);
-//void stable_v_error_handler(int errnum);
-
-
 /************************************************************************
  ************************************************************************
  * Parameter estimation                                                 *
@@ -496,6 +543,9 @@ typedef struct {
 	unsigned int length;
 	double nu_c;
 	double nu_z;
+	unsigned int bins;  /* Bins of the binned likelihood, 0 to use every sample */
+	double *edges;      /* bins - 1 edges between them */
+	double *counts;     /* Samples in each bin */
 }
 stable_like_params;
 
@@ -514,6 +564,19 @@ int stable_fit_mle2d(StableDist *dist, const double *data, const unsigned int le
 
 int stable_fit_whole(StableDist *dist, const double *data, const unsigned int length);
 
+/* Maximum likelihood fit of the four parameters, as stable_fit_whole, with a
+   BFGS minimizer on the gradient of the log-likelihood from stable_pdf_grad.
+   Starts from the McCulloch estimation and converges in a few tens of
+   evaluations of the PDF and its derivatives. */
+int stable_fit_mle_grad(StableDist *dist, const double *data, const unsigned int length);
+
+/* Maximum likelihood fit of the four parameters in stages: the simplex of
+   stable_fit_whole on random subsamples of 1000, 10000, ... samples, each one
+   starting from the estimation of the previous, and last on all the data.
+   Starts from the McCulloch and Koutrouvelis estimations of the first
+   subsample. */
+int stable_fit_mle_stages(StableDist *dist, const double *data, const unsigned int length);
+
 /* Auxiliary functions */
 
 gsl_complex stable_samplecharfunc_point(const double x[],
@@ -542,10 +605,62 @@ double stable_minusloglikelihood(const gsl_vector * theta, void * p);
  * Random numbers generation                                            *
  ************************************************************************
  ************************************************************************/
-void stable_rnd(StableDist *dist, double*rnd, const unsigned int n);
+/* Variate i of stream s is computed directly from the key set by
+   stable_rnd_seed, i and s with a counter-based generator, so the output
+   only depends on them, not on the THREADS threads that share the blocks.
+   stable_rnd and stable_rnd_point continue the stream of the distribution
+   from its current index (stream 0 and index 0 after stable_rnd_seed), and
+   stable_rnd_seek moves them to any other position. stable_rnd_stream
+   generates variates first, ..., first + n - 1 of a stream without changing
+   the position of the distribution. Both return -1 if rnd is NULL. */
+short stable_rnd(StableDist *dist, double*rnd, const unsigned int n);
+short stable_rnd_stream(const StableDist *dist, uint64_t stream, uint64_t first,
+						double *rnd, const unsigned int n);
 short stable_rnd_gpu(StableDist *dist, double*rnd, const unsigned int n);
 
 double stable_rnd_point(StableDist *dist);
 
+/* Transforms of n pairs of uniforms u, w in (0, 1) into variates, one for
+   each ZONE and for beta = 0, and the inverse transform of u through the
+   quantile table of stable_rnd_table_build */
+void stable_rnd_transform_STABLE(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n);
+void stable_rnd_transform_SYMMETRIC(const StableDist *dist, const double u[],
+									const double w[], double rnd[], int n);
+void stable_rnd_transform_ALFA_1(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n);
+void stable_rnd_transform_GAUSS(const StableDist *dist, const double u[],
+								const double w[], double rnd[], int n);
+void stable_rnd_transform_CAUCHY(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n);
+void stable_rnd_transform_LEVY(const StableDist *dist, const double u[],
+							   const double w[], double rnd[], int n);
+void stable_rnd_transform_TABLE(const StableDist *dist, const double u[],
+								const double w[], double rnd[], int n);
+
 void stable_rnd_seed(StableDist * dist, unsigned long int s);
+void stable_rnd_seek(StableDist *dist, uint64_t stream, uint64_t index);
+
+/* Quasi-random variates from the points of the Sobol sequence, with index
+   and stream as in stable_rnd, so that means over them converge close to
+   O(1/N) instead of O(1/sqrt(N)). mode is a combination of the flags below.
+   Without scrambling all streams are the same sequence, whose first point
+   (index 0) is the corner of the unit square, usually skipped. */
+short stable_rnd_qmc(StableDist *dist, double *rnd, const unsigned int n, int mode);
+
+/* Unbounded reading of the stream of dist from its current position, which
+   the iterator does not change. Blocks of `block` variates are generated in
+   the background by THREADS threads into a ring of `slots` blocks (0 takes
+   the defaults), so only the ring is kept in memory. stable_rnd_iter_next
+   returns the unread variates of the current block in *rnd, valid until the
+   next call; stable_rnd_iter_read copies the next n variates to rnd. Either
+   way the numbers are the ones stable_rnd would return. The iterator works on
+   a copy of dist, so later changes of dist do not affect it. */
+struct stable_rnd_iter;
+
+struct stable_rnd_iter *stable_rnd_iter_create(const StableDist *dist, size_t block,
+		unsigned int slots);
+size_t stable_rnd_iter_next(struct stable_rnd_iter *it, const double **rnd);
+short stable_rnd_iter_read(struct stable_rnd_iter *it, double *rnd, size_t n);
+void stable_rnd_iter_free(struct stable_rnd_iter *it);
 #endif //STABLE_API_H
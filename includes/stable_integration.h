@@ -41,10 +41,53 @@
 
 int stable_integration_METHODNAME(char *s);
 
+gsl_integration_workspace *stable_integration_workspace(size_t limit);
+
+void stable_eval_ctx_init(StableEvalCtx *ctx, const StableDist *dist);
+
 void
-stable_integration(StableDist *dist, double(function)(double, void*),
+stable_integration_GK21(StableEvalCtx *ctx, double(function)(double, void *),
+						double a, double b,
+						double epsabs, double epsrel, unsigned short limit,
+						double *result, double *abserr);
+
+void
+stable_integration(StableEvalCtx *ctx, double(function)(double, void*),
 				   double a, double b,
 				   double epsabs, double epsrel, unsigned short limit,
 				   double *result, double *abserr, unsigned short method);
 
+/* log(g) of the alfa = 1 integrands, V(theta) + xxipow */
+double stable_g_aux1(double theta, void *args);
+
+/* Integrals of the CDF integrand, the PDF integrand and e^g times the PDF
+   integrand (result[0..2]) on the same nodes, from theta[0] to
+   theta[n_theta - 1] starting with the intervals between the points given */
+void
+stable_integration_pcdf(StableEvalCtx *ctx, const double theta[], int n_theta,
+						double epsabs, double epsrel, unsigned short limit,
+						double result[3], double abserr[3]);
+
+/* Integrals of the PDF integrand, e^g times it, and the derivatives of the
+   PDF integrand with respect to two parameters (result[0..3]) on the same
+   nodes, with the tolerances of the derivatives relative to the PDF. For
+   each parameter, dv[k] holds the coefficients of
+       d log(V) / dp = dv[k][0] L - (dv[k][1] t + dv[k][2]) T + dv[k][3],
+   t = theta0_ + theta, L = log(cos(theta) / sin(alfa t)) and
+   T = alfainvalfa1 cot(alfa t) + tan(alfa t - theta). The part of dg/dp that
+   comes from xxipow, the same on all nodes, is left to the caller. Only for
+   the STABLE zone. */
+void
+stable_integration_pdf_grad(StableEvalCtx *ctx, const double dv[2][4],
+							const double theta[], int n_theta,
+							double epsabs, double epsrel, unsigned short limit,
+							double result[4], double abserr[4]);
+
+/* Points that hold the peak of the PDF integrand apart for the joint passes:
+   the ends of the interval, the maximum (g = 0) and where the integrand
+   becomes negligible on each side of it. Returns how many were stored, 2 (the
+   ends) if the maximum was not found. */
+int stable_integration_peak(StableEvalCtx *ctx, double(*auxiliar)(double, void *),
+							double theta[5]);
+
 #endif
@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STABLE_INV_TABLE_H
+#define STABLE_INV_TABLE_H
+
+#include <math.h>
+
+/*
+ * Quantiles of the standard distribution (sigma = 1, mu_0 = 0) used as the
+ * initial guess of stable_inv_point, replacing the coarse precalc grid of
+ * stable_inv_precalcs.h (which the OpenCL kernels still use).
+ *
+ * The table holds alfa asinh(x(q)), which goes from linear around the center
+ * to alfa log(2|x|) ~ -log(q) on the tails, where x(q) ~ q^(-1/alfa). It is
+ * sampled on a grid of alfa, of beta >= 0 (x(q; -beta) = -x(1 - q; beta)) and
+ * of u = log(q / (1 - q)), so q is log-spaced near 0 and 1. Values between the
+ * nodes are interpolated with monotone (Steffen) cubics on each axis. Beyond
+ * the last q of the grid the tails follow the power law from the last node.
+ *
+ * The weight of the power law tails vanishes as alfa -> 2 and beta -> 1 (on
+ * the left tail), and the tail quantiles move with its logarithm, so the nodes
+ * of alfa and beta are uniform on the coordinates below, which stretch
+ * logarithmically towards those ends. alfa = 2 is left out of the grid, as the
+ * normal distribution is solved exactly.
+ *
+ * srclib/libstable/stable_inv_table.c is generated by src/gen_inv_table.c
+ * with the grid defined here. It also measures the interpolation error of
+ * asinh(x) on random points of each cell of alfa and beta, and keeps the
+ * largest one in stable_inv_guess_err, so the error of x there is about
+ * stable_inv_guess_err sqrt(1 + x^2).
+ */
+
+#define STABLE_INV_TABLE_ALFA_COORD(alfa) ((alfa) - 0.1 * log(2.0 - (alfa)))
+#define STABLE_INV_TABLE_ALFA_MIN 0.1
+#define STABLE_INV_TABLE_ALFA_MAX 1.999
+#define STABLE_INV_TABLE_NA 54
+
+#define STABLE_INV_TABLE_BETA_COORD(beta) ((beta) - 0.1 * log(1.001 - (beta)))
+#define STABLE_INV_TABLE_NB 18   // beta in [0, 1]
+
+#define STABLE_INV_TABLE_U_MIN (-23.0)
+#define STABLE_INV_TABLE_U_STEP 0.25
+#define STABLE_INV_TABLE_NU 185  // q in [1e-10, 1 - 1e-10]
+
+#define STABLE_INV_TABLE_INDEX(ia, ib, iu) \
+	(((ia) * STABLE_INV_TABLE_NB + (ib)) * STABLE_INV_TABLE_NU + (iu))
+
+extern const double stable_inv_guess[STABLE_INV_TABLE_NA * STABLE_INV_TABLE_NB *
+									 STABLE_INV_TABLE_NU];
+extern const double stable_inv_guess_err[(STABLE_INV_TABLE_NA - 1) * (STABLE_INV_TABLE_NB - 1)];
+
+/* Quantile q of the standard distribution interpolated on a table with the
+   layout above (stable_inv_guess, or one being generated) */
+double stable_inv_guess_interp(const double *table, double alfa, double beta, double q);
+
+#endif
@@ -0,0 +1,232 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STABLE_KERNELS_H
+#define STABLE_KERNELS_H
+
+#include "stable_api.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Integrands evaluated on a whole set of nodes at once (stable_pdf_g2_nodes
+ * and the like), with the same values as the scalar ones.
+ *
+ * libm functions are opaque calls, so a loop that uses them is evaluated one
+ * node at a time. The kernels use instead the functions below, fdlibm
+ * polynomials written without branches or calls, so that the loop over the
+ * nodes is vectorized by the compiler with the instruction set of the build
+ * (-march=native in the release one: AVX2 or AVX-512 evaluate 4 or 8 nodes
+ * per instruction). Special cases are resolved with selects at the end.
+ *
+ * Errors are of a few ulp. Arguments of sin and cos are reduced with a two
+ * term pi/2, which is exact enough for the |x| < 100 the integrands use.
+ */
+
+typedef void (*stable_nodes_integrand)(StableEvalCtx *ctx, const double theta[],
+									   double g[], int n);
+
+/* Scalar integrands that have a node kernel */
+double stable_pdf_g1(double theta, void *args);
+double stable_pdf_g2(double theta, void *args);
+double stable_g_aux2(double theta, void *args);
+double stable_cdf_g2(double theta, void *args);
+
+void stable_pdf_g1_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n);
+void stable_pdf_g2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n);
+void stable_g_aux2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n);
+void stable_cdf_g2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n);
+
+static inline uint64_t stable_vm_bits(double x)
+{
+	uint64_t u;
+	memcpy(&u, &x, sizeof(u));
+	return u;
+}
+
+static inline double stable_vm_double(uint64_t u)
+{
+	double x;
+	memcpy(&x, &u, sizeof(x));
+	return x;
+}
+
+/* Rounds x to the nearest integer, |x| < 2^51 */
+static inline double stable_vm_round(double x)
+{
+	const double shift = 6755399441055744.0; // 1.5 * 2^52
+
+	return (x + shift) - shift;
+}
+
+/* 2^k for an integer k in [-1022, 1023] */
+static inline double stable_vm_pow2(double k)
+{
+	return stable_vm_double(stable_vm_bits(k + 1023.0 + 4503599627370496.0) << 52);
+}
+
+/* Integer k mod 4 */
+static inline uint64_t stable_vm_mod4(double k)
+{
+	return stable_vm_bits(k + 6755399441055744.0) & 3;
+}
+
+static inline double stable_vm_exp(double x)
+{
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+	double k, r, p, xc;
+
+	xc = x < -745.2 ? -745.2 : (x > 709.782712893384 ? 709.782712893384 : x);
+	k = stable_vm_round(xc * M_LOG2E);
+	r = (xc - k * ln2_hi) - k * ln2_lo;
+
+	/* Taylor polynomial of degree 12 on |r| < ln2/2 */
+	p = 2.08767569878680989792e-09;
+	p = p * r + 2.50521083854417187751e-08;
+	p = p * r + 2.75573192239858906526e-07;
+	p = p * r + 2.75573192239858906526e-06;
+	p = p * r + 2.48015873015873015873e-05;
+	p = p * r + 1.98412698412698412698e-04;
+	p = p * r + 1.38888888888888888889e-03;
+	p = p * r + 8.33333333333333333333e-03;
+	p = p * r + 4.16666666666666666667e-02;
+	p = p * r + 1.66666666666666666667e-01;
+	p = p * r + 0.5;
+	p = p * r + 1.0;
+	p = p * r + 1.0;
+
+	/* Scaled in two steps, so k can be out of the range of normal numbers */
+	p *= stable_vm_pow2(k < 0 ? k + 54.0 : k - 1.0);
+	p *= k < 0 ? 5.5511151231257827e-17 : 2.0;
+
+	p = x < -745.2 ? 0.0 : p;
+	p = x > 709.782712893384 ? INFINITY : p;
+
+	return x == x ? p : x;
+}
+
+/* Square root of x >= 0 without subnormals. libm sqrt may set errno, so the
+   compiler does not vectorize it without -fno-math-errno */
+static inline double stable_vm_sqrt(double x)
+{
+	double y, s;
+
+	/* 1/sqrt(x) from a guess on the exponent bits and Newton steps, each one
+	   squaring the relative error from the initial 4% */
+	y = stable_vm_double(0x5fe6eb50c7b537a9ULL - (stable_vm_bits(x) >> 1));
+	y = y * (1.5 - 0.5 * x * y * y);
+	y = y * (1.5 - 0.5 * x * y * y);
+	y = y * (1.5 - 0.5 * x * y * y);
+	y = y * (1.5 - 0.5 * x * y * y);
+
+	s = x * y;
+	s = s + 0.5 * y * (x - s * s);
+
+	return x == INFINITY ? INFINITY : s;
+}
+
+static inline double stable_vm_log(double x)
+{
+	const double ln2_hi = 6.93147180369123816490e-01;
+	const double ln2_lo = 1.90821492927058770002e-10;
+	double sub, m, e, f, s, z, hfsq, R, r;
+	uint64_t u;
+
+	/* Subnormals are scaled by 2^54 */
+	sub = x < 2.2250738585072014e-308 ? 1.0 : 0.0;
+	u = stable_vm_bits(x * (sub != 0.0 ? 18014398509481984.0 : 1.0));
+
+	/* x = 2^e m, sqrt(2)/2 < m < sqrt(2) */
+	e = stable_vm_double(0x4330000000000000ULL | (u >> 52 & 0x7ff)) - 4503599627370496.0
+		- 1023.0 - 54.0 * sub;
+	m = stable_vm_double((u & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL);
+	e = m > M_SQRT2 ? e + 1.0 : e;
+	m = m > M_SQRT2 ? 0.5 * m : m;
+
+	f = m - 1.0;
+	s = f / (2.0 + f);
+	z = s * s;
+	R = z * (6.666666666666735130e-01 + z * (3.999999999940941908e-01 +
+			 z * (2.857142874366239149e-01 + z * (2.222219843214978396e-01 +
+					 z * (1.818357216161805012e-01 + z * (1.531383769920937332e-01 +
+							 z * 1.479819860511658591e-01))))));
+	hfsq = 0.5 * f * f;
+	r = e * ln2_hi - ((hfsq - (s * (hfsq + R) + e * ln2_lo)) - f);
+
+	r = x == INFINITY ? INFINITY : r;
+	r = x == 0.0 ? -INFINITY : r;
+
+	return x >= 0.0 ? r : NAN;
+}
+
+/* x = k pi/2 + r, |r| < pi/4. Returns k */
+static inline double stable_vm_reduce(double x, double *r)
+{
+	const double pio2_1 = 1.57079632673412561417e+00;  // First 33 bits of pi/2
+	const double pio2_1t = 6.07710050650619224932e-11; // pi/2 - pio2_1
+	double k = stable_vm_round(x * M_2_PI);
+
+	*r = (x - k * pio2_1) - k * pio2_1t;
+
+	return k;
+}
+
+static inline double stable_vm_sin_poly(double r)
+{
+	double z = r * r;
+
+	return r + r * z * (-1.66666666666666324348e-01 + z * (8.33333333332248946124e-03 +
+						z * (-1.98412698298579493134e-04 + z * (2.75573137070700676789e-06 +
+								z * (-2.50507602534068634195e-08 + z * 1.58969099521155010221e-10)))));
+}
+
+static inline double stable_vm_cos_poly(double r)
+{
+	double z = r * r, hz = 0.5 * z, w = 1.0 - hz;
+
+	return w + (((1.0 - w) - hz) + z * z * (4.16666666666666019037e-02 +
+				z * (-1.38888888888741095749e-03 + z * (2.48015872894767294178e-05 +
+						z * (-2.75573143513906633035e-07 + z * (2.08757232129817482790e-09 +
+								z * -1.13596475577881948265e-11))))));
+}
+
+static inline double stable_vm_sin(double x)
+{
+	double r, k = stable_vm_reduce(x, &r), s, c, v;
+	uint64_t q = stable_vm_mod4(k);
+
+	s = stable_vm_sin_poly(r);
+	c = stable_vm_cos_poly(r);
+	v = q & 1 ? c : s;
+
+	return q & 2 ? -v : v;
+}
+
+static inline double stable_vm_cos(double x)
+{
+	double r, k = stable_vm_reduce(x, &r), s, c, v;
+	uint64_t q = stable_vm_mod4(k);
+
+	s = stable_vm_sin_poly(r);
+	c = stable_vm_cos_poly(r);
+	v = q & 1 ? -s : c;
+
+	return q & 2 ? -v : v;
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STABLE_POOL_H
+#define STABLE_POOL_H
+
+#include "stable_api.h"
+#include <pthread.h>
+
+/*
+ * Persistent pool of worker threads shared by the batch functions (stable_pdf,
+ * stable_cdf, stable_inv, stable_rnd). The pool is created the first time a
+ * batch function needs it, with THREADS workers, and destroyed whenever
+ * stable_set_THREADS changes the number of threads, so it is rebuilt with the
+ * new size on the next call. A job can run on fewer workers than that (the
+ * THREADS of the distribution configuration), but never on more.
+ *
+ * Distributions are only read during evaluation, so the workers share the
+ * caller's one and a batch call only pays for waking them up.
+ */
+
+struct stable_pool;
+
+struct stable_worker {
+	pthread_t thread;
+	unsigned int index;  // Index of this worker, in [0, count)
+	unsigned int count;  // Number of workers sharing the current job
+	struct stable_pool *pool;
+};
+
+typedef void (*stable_pool_job)(struct stable_worker *worker, void *args);
+
+struct stable_pool {
+	struct stable_worker *workers;
+	unsigned int size;
+	pthread_mutex_t lock;
+	pthread_cond_t job_ready;
+	pthread_cond_t job_done;
+	unsigned long generation; // Incremented on each dispatched job
+	unsigned int pending;     // Workers that have not finished the current job
+	unsigned int active;      // Workers taking part in the current job
+	stable_pool_job job;
+	void *args;
+	short shutdown;
+};
+
+void stable_pool_run(unsigned int threads, stable_pool_job job, void *args);
+
+/*
+ * Points are handed out to the workers in chunks of CHUNK_SIZE consecutive
+ * indexes (or an automatic size when CHUNK_SIZE is 0) through an atomic
+ * counter, so threads that finish early keep taking work from the others.
+ * stable_pool_take stores the next chunk in [begin, end) and returns 0 when
+ * the N points have already been taken. The counter must be 0 before the job
+ * is dispatched.
+ */
+#define STABLE_POOL_MAX_GRAIN 64
+
+unsigned int stable_pool_grain(const struct stable_worker *worker, const int N);
+int stable_pool_take(const struct stable_worker *worker, int *next,
+					 const int N, int *begin, int *end);
+void stable_pool_resize();
+
+#endif
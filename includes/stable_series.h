@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STABLE_SERIES_H
+#define STABLE_SERIES_H
+
+struct StableDistStruct;
+
+/*
+ * Tail expansions of the standard (sigma = 1, mu_0 = 0) PDF and CDF, in powers
+ * of the distance y to xi (Zolotarev, 1986, and Bergstrom, 1952). With
+ * r = sqrt(1 + xi^2), on the right tail
+ *
+ *   pdf(y)     ~ 1/pi sum_k (-1)^(k+1) r^k Gamma(alfa k + 1)/k! sin(alfa k (pi/2 + theta0)) y^(-alfa k - 1)
+ *   1 - cdf(y) ~ 1/pi sum_k (-1)^(k+1) r^k Gamma(alfa k)/k!     sin(alfa k (pi/2 + theta0)) y^(-alfa k)
+ *
+ * which converge for alfa < 1 and are asymptotic otherwise. The left tail is
+ * the right one of the distribution with -beta (theta0 changes its sign).
+ *
+ * With alfa = 1 the terms also depend on log(y): each one comes from the
+ * derivatives of Gamma(s) (iy)^(-s) with respect to s, so they are obtained
+ * with the polygamma functions at integer arguments.
+ *
+ * Tail probabilities are given instead of the CDF on both tails, so they keep
+ * their relative precision. On the short tail of a totally skewed distribution
+ * (beta = 1 on the left, beta = -1 on the right) all the terms vanish, as the
+ * tail is empty or decays exponentially, so the series gives 0.
+ *
+ * Distributions keep the expansions of both tails (StableDist tail), which the
+ * evaluation of the PDF and CDF uses instead of the numerical integration
+ * where they are precise enough (STABLE_EVAL_TAILS).
+ *
+ * Around xi the standard (S1) characteristic function exp(-r |t|^alfa e^(i phi0
+ * sign(t))), phi0 = -alfa theta0, gives termwise the power series
+ *
+ *   pdf(y) = 1/(pi alfa) sum_k Gamma((k+1)/alfa)/k! cos(k pi/2 + phi0 (k+1)/alfa) r^(-(k+1)/alfa) y^k
+ *
+ * and its integral from xi for the CDF, which starts at 1/2 - theta0/pi. The
+ * first term is the constant previously used within XXI_TH of xi. The series
+ * converges for alfa > 1 and is asymptotic for alfa < 1, so it is summed only
+ * until its last terms are under the tolerance, which sets the radius where
+ * it is used (STABLE_EVAL_CENTER). It is not used with alfa < 1 and
+ * beta = +-1, where all the terms but the first one of the CDF vanish.
+ */
+
+#define STABLE_SERIES_TERMS 10
+#define STABLE_SERIES_CHECKS 3  // Consecutive points that must reach the tolerance
+#define STABLE_CENTER_TERMS 40  // Maximum # of terms of the series around xi
+
+struct stable_tail_series {
+	int function;   // PDF or CDF
+	double alfa;
+	double r;       // sqrt(1 + xi^2), the series is on powers of r y^(-alfa)
+	double c;       // 2 beta / pi of the tail, with alfa = 1
+	short zero;     // Light tail of a totally skewed distribution
+	double coef[STABLE_SERIES_TERMS];
+	double lgam[STABLE_SERIES_TERMS];  // log Gamma(s) of each term, alfa = 1
+	double psi[STABLE_SERIES_TERMS][STABLE_SERIES_TERMS]; // psi^(j)(s), alfa = 1
+};
+
+struct stable_center_series {
+	int function;   // PDF or CDF
+	short usable;
+	unsigned int terms;  // Terms with a finite coefficient
+	double value0;  // Value at xi
+	double coef[STABLE_CENTER_TERMS];  // Coefficient of y^k (PDF), y^(k+1) (CDF)
+};
+
+void stable_tail_series_init(struct stable_tail_series *series,
+							 const struct StableDistStruct *dist, int function,
+							 short left);
+
+double stable_tail_series_eval(const struct stable_tail_series *series,
+							   double y, double *err);
+
+double stable_tail_series_reach(const struct stable_tail_series *series, double tol);
+
+short stable_tail_series_point(const struct stable_tail_series *series,
+							   double y, double tol, double *value, double *err);
+
+void stable_center_series_init(struct stable_center_series *series,
+							   const struct StableDistStruct *dist, int function);
+
+short stable_center_series_point(const struct stable_center_series *series,
+								 double y, double tol, double *value, double *err);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STABLE_TABLE_H
+#define STABLE_TABLE_H
+
+#include "stable_api.h"
+#include "stable_series.h"
+
+/*
+ * Tabulated PDF and CDF of a distribution (stable_pdf_table, stable_cdf_table).
+ *
+ * Functions are tabulated once for the standard distribution (sigma = 1,
+ * mu_0 = 0) from the numerical integration, so changing sigma or mu keeps the
+ * table. Each side of the median is a half: the left one holds log(pdf) or
+ * log(cdf) of the distribution, and the right one the same values of the
+ * distribution with -beta, as pdf(x; beta) = pdf(-x; -beta) and
+ * 1 - cdf(x; beta) = cdf(-x; -beta). So tail probabilities on the right keep
+ * their relative precision instead of being rounded against 1.
+ *
+ * Halves are stored over u = -asinh(d), d the distance to the median, where
+ * the power law tails are almost straight lines, as adjacent intervals with a
+ * Chebyshev expansion of STABLE_TABLE_ORDER terms each. Intervals are split in
+ * two until the error at STABLE_TABLE_TESTS points between the Chebyshev
+ * nodes, compared with the numerical integration, is under the tolerance.
+ * Halves end where the tail expansion (stable_series.h) reaches a tenth of the
+ * tolerance, which is evaluated instead from there on.
+ *
+ * The CDF table is also inverted for bulk quantiles (stable_inv_table): log(q)
+ * or log(1 - q) is looked up by binary search among the pieces of a half,
+ * whose values grow towards the median, and solved for u inside the piece.
+ *
+ * For random variates (stable_rnd_table_build) the quantile function itself is
+ * tabulated: y = asinh(x(q)) of the standard distribution on nodes uniform in
+ * t = log(q / (1 - q)), |t| <= STABLE_TABLE_RND_TMAX, solved with stable_inv
+ * (on the distribution with -beta for q > 1/2), with the derivative
+ * dy/dt = q (1 - q) / (pdf(x) sqrt(1 + x^2)). Samples are cubic Hermite
+ * interpolations of y at t(u), and past the last nodes y goes on linearly
+ * with t, which is the power law x ~ q^(-1/alfa) of the tails. The step is
+ * halved until the error of y, checked against stable_inv halfway between the
+ * nodes, is under the tolerance.
+ */
+
+#define STABLE_TABLE_ORDER 16       // Chebyshev terms per interval
+#define STABLE_TABLE_TESTS 3        // Test points per interval
+#define STABLE_TABLE_INITIAL 8      // Initial intervals per half
+#define STABLE_TABLE_MAX_DEPTH 14   // Maximum # of splits of an initial interval
+#define STABLE_TABLE_MAX_PIECES 4096 // Maximum # of intervals per half
+#define STABLE_TABLE_MIN_TOL 1e-12  // Tighter tolerances are not achievable
+#define STABLE_TABLE_LOG_MIN (-690.0) // log of values taken as 0 (~1e-300)
+#define STABLE_TABLE_FLOOR 1e-280   // Values under this are compared in absolute
+#define STABLE_TABLE_ZERO_REACH 1e4 // Maximum length of a half without tail
+#define STABLE_TABLE_ZERO_ITER 20   // Bisection steps for the end of such a half
+#define STABLE_TABLE_INV_ITER 64    // Maximum # of steps inverting a piece or tail
+#define STABLE_TABLE_INV_TOL 1e-14  // Tolerance of those steps
+#define STABLE_TABLE_RND_TMAX 23.0  // Quantile nodes for q in [1e-10, 1 - 1e-10]
+#define STABLE_TABLE_RND_STEP 0.25  // Initial step of t between the nodes
+#define STABLE_TABLE_RND_HALVINGS 5 // Maximum # of times the step is halved
+
+struct stable_table_piece {
+	double a, b;   // Interval of u
+	double err;    // Relative error measured on the test points
+	double c[STABLE_TABLE_ORDER];
+};
+
+struct stable_table_half {
+	struct stable_table_piece *pieces;  // Sorted by u
+	unsigned int n;
+	unsigned int *lookup;  // First interval of each cell of u
+	unsigned int cells;
+	double umin;           // The half covers [umin, 0]
+	double scale;          // cells / -umin
+	double dmax;           // Distance to the median at umin
+	double shift;          // Distance from xi to the median
+	struct stable_tail_series tail;
+	double tail_err;       // Relative error of the tail expansion
+};
+
+struct stable_table_fn {
+	struct stable_table_half half[2];
+	struct stable_table_info info;
+	short built;
+};
+
+struct stable_table_rnd {
+	double *y;             // asinh(x) at the nodes t = tmin + k step
+	double *m;             // step dy/dt at the nodes
+	unsigned int n;        // # of nodes
+	double tmin, step;
+	struct stable_table_info info;
+	short built;
+};
+
+struct stable_table {
+	double alfa, beta;     // Parameters of the tabulated distribution
+	double center;         // Median of the standard distribution
+	struct stable_table_fn fn[2]; // Indexed by CDF and PDF
+	struct stable_table_rnd rnd;  // Quantiles for random variates
+};
+
+short stable_table_rnd_ready(const StableDist *dist);
+
+/* Duplicates the quantile table of src in dst, which has the same alfa and
+   beta (stable_copy), so both draw the same variates. Returns -1 if it can not
+   be allocated */
+short stable_table_rnd_copy(StableDist *dst, const StableDist *src);
+
+#endif
@@ -97,6 +97,29 @@ struct fitresult {
 #define SIGMA_START SIGMA_INCR
 #endif
 
+/* Bins of the binned likelihood in MLB, 10 samples per bin with the default
+   N. Compared with MLE, it shows the variance that the binning adds */
+#define BINNED_FIT_BINS 100
+
+static int fit_mle_binned(StableDist *dist, const double *data, const unsigned int length)
+{
+	struct stable_config cfg;
+	unsigned int bins;
+	int status;
+
+	stable_get_config(dist, &cfg);
+	bins = cfg.FIT_BINS;
+	cfg.FIT_BINS = BINNED_FIT_BINS;
+	stable_set_config(dist, &cfg);
+
+	status = stable_fit_mle(dist, data, length);
+
+	cfg.FIT_BINS = bins;
+	stable_set_config(dist, &cfg);
+
+	return status;
+}
+
 int main(int argc, char *argv[])
 {
 	double alfa, beta, sigma, mu_0;
@@ -107,11 +130,12 @@ int main(int argc, char *argv[])
 	size_t test_count = 0;
 	double total_duration, start, end;
 	struct fittest tests[] = {
-		//{ stable_fit_mle, 0, "MLE" },
+		{ stable_fit_mle, 0, "MLE" },
 		//{ stable_fit_mle2d, 0, "M2D"},
 		//{ stable_fit_koutrouvelis, 0, "KTR"},
 		//{ stable_fit_koutrouvelis, 1, "KTR"},
 		//{ stable_fit_mle, 1, "MLE" },
+		{ fit_mle_binned, 0, "MLB" },
 		// { stable_fit_mle2d, 1, "M2D"},
 		{ stable_fit_grid, 1, "GRD" },
 		// { stable_fit_grid, 0, "GRD" }
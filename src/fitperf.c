@@ -90,6 +90,8 @@ int main(int argc, char *argv[])
 		//{ stable_fit_mle2d, 0, "M2D"},
 		//{ stable_fit_koutrouvelis, 0, "KTR"},
 		{ stable_fit_mle, 1, "MLE" },
+		{ stable_fit_mle_grad, 0, "MLG" },
+		{ stable_fit_mle_stages, 0, "MLS" },
 		{ stable_fit_mle2d, 1, "M2D"},
 		{ stable_fit_koutrouvelis, 1, "KTR"},
 		{ stable_fit_grid, 1, "GRD" },
@@ -112,6 +114,10 @@ int main(int argc, char *argv[])
 	Nexp = 10;
 	seed = -1;
 
+	/* Size of the sample, large enough for the stages of MLS */
+	if (argc > 1)
+		N = atoi(argv[1]);
+
 	printf("Parameters for the random data generated:\n");
 	printf("α\t%lf\n", alfa);
 	printf("β\t%lf\n", beta);
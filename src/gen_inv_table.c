@@ -0,0 +1,286 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Generates the quantile table of stable_inv_table.h on the grid defined
+ * there, and writes srclib/libstable/stable_inv_table.c to stdout:
+ *
+ *     gen_inv_table [CHECKS] > srclib/libstable/stable_inv_table.c
+ *
+ * Quantiles are solved on asinh(x) from the CDF, on the lower tail of the
+ * distribution with beta or -beta, so tail probabilities keep their relative
+ * precision. The interpolation is then checked against the solved quantile on
+ * CHECKS random points of each cell of alfa and beta (20 by default), whose
+ * largest errors are written as stable_inv_guess_err. Progress and error
+ * statistics go to stderr.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "stable_api.h"
+#include "stable_inv_table.h"
+
+#define SOLVE_TOL 1e-12  // Tolerance of asinh(x)
+#define SOLVE_MAXITER 200
+
+static double log_cdf(StableDist *dist, double y)
+{
+	double x = sinh(y), cdf;
+
+	stable_cdf(dist, &x, 1, &cdf, NULL);
+
+	return cdf > 0 ? log(cdf) : -INFINITY;
+}
+
+/* asinh of the quantile p <= 1/2, starting the search at y0 */
+static double solve_lower(StableDist *dist, double p, double y0)
+{
+	double lp = log(p), ya, yb, ga, gb, y, g, step = 0.5;
+	int k, side = 0;
+
+	ya = y0 - step;
+	yb = y0 + step;
+	ga = log_cdf(dist, ya) - lp;
+	gb = log_cdf(dist, yb) - lp;
+
+	for (k = 0; ga > 0 && k < SOLVE_MAXITER; k++) {
+		yb = ya;
+		gb = ga;
+		step *= 2;
+		ya -= step;
+		ga = log_cdf(dist, ya) - lp;
+	}
+
+	for (k = 0; gb < 0 && k < SOLVE_MAXITER; k++) {
+		ya = yb;
+		ga = gb;
+		step *= 2;
+		yb += step;
+		gb = log_cdf(dist, yb) - lp;
+	}
+
+	/* Illinois method, with bisection while an end is out of the support */
+	for (k = 0; yb - ya > SOLVE_TOL && k < SOLVE_MAXITER; k++) {
+		if (isinf(ga) || isinf(gb))
+			y = 0.5 * (ya + yb);
+		else
+			y = (ya * gb - yb * ga) / (gb - ga);
+
+		if (!(y > ya && y < yb))
+			y = 0.5 * (ya + yb);
+
+		g = log_cdf(dist, y) - lp;
+
+		if (g == 0)
+			return y;
+
+		if (g < 0) {
+			ya = y;
+			ga = g;
+
+			if (side == -1)
+				gb *= 0.5;
+
+			side = -1;
+		} else {
+			yb = y;
+			gb = g;
+
+			if (side == 1)
+				ga *= 0.5;
+
+			side = 1;
+		}
+	}
+
+	return 0.5 * (ya + yb);
+}
+
+/* asinh(x(q)) of the standard distribution, with u = log(q / (1 - q)) */
+static double solve(StableDist *lower, StableDist *upper, double u, double y0)
+{
+	if (u <= 0)
+		return solve_lower(lower, 1.0 / (1.0 + exp(-u)), y0);
+	else
+		return -solve_lower(upper, 1.0 / (1.0 + exp(u)), -y0);
+}
+
+static double alfa_coord(double alfa)
+{
+	return STABLE_INV_TABLE_ALFA_COORD(alfa);
+}
+
+static double beta_coord(double beta)
+{
+	return STABLE_INV_TABLE_BETA_COORD(beta);
+}
+
+/* Value in [a, b] of node i of n uniform on the coordinate */
+static double grid_node(double (*coord)(double), double a, double b, int i, int n)
+{
+	double c = coord(a) + i * (coord(b) - coord(a)) / (n - 1), m;
+
+	if (i == 0 || i == n - 1)
+		return i == 0 ? a : b;
+
+	while (b - a > 1e-15) {
+		m = 0.5 * (a + b);
+
+		if (coord(m) < c)
+			a = m;
+		else
+			b = m;
+	}
+
+	return 0.5 * (a + b);
+}
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+static double rand_in(double a, double b)
+{
+	return a + (b - a) * (rand() / (RAND_MAX + 1.0));
+}
+
+int main(int argc, char *argv[])
+{
+	const int N = STABLE_INV_TABLE_NA * STABLE_INV_TABLE_NB * STABLE_INV_TABLE_NU;
+	const int Ncells = (STABLE_INV_TABLE_NA - 1) * (STABLE_INV_TABLE_NB - 1);
+	const int mid = (int)floor(-STABLE_INV_TABLE_U_MIN / STABLE_INV_TABLE_U_STEP);
+	int checks = argc > 1 ? atoi(argv[1]) : 20;
+	int ia, ib, iu, k, n = 0;
+	double alfas[STABLE_INV_TABLE_NA], betas[STABLE_INV_TABLE_NB];
+	double alfa, beta, u, y, *table, *cell_err, *errors;
+	StableDist *lower, *upper;
+
+	table = malloc(N * sizeof(double));
+	cell_err = calloc(Ncells, sizeof(double));
+	errors = malloc(max(Ncells * checks, 1) * sizeof(double));
+	lower = stable_create(1.0, 0.0, 1.0, 0.0, 0);
+	upper = stable_create(1.0, 0.0, 1.0, 0.0, 0);
+
+	if (table == NULL || cell_err == NULL || errors == NULL || lower == NULL || upper == NULL) {
+		fprintf(stderr, "Error en la reserva de memoria\n");
+		return 1;
+	}
+
+	stable_set_THREADS(1);
+	stable_set_relTOL(1e-12);
+	stable_set_absTOL(1e-300);
+
+	for (ia = 0; ia < STABLE_INV_TABLE_NA; ia++)
+		alfas[ia] = grid_node(alfa_coord, STABLE_INV_TABLE_ALFA_MIN, STABLE_INV_TABLE_ALFA_MAX,
+							  ia, STABLE_INV_TABLE_NA);
+
+	for (ib = 0; ib < STABLE_INV_TABLE_NB; ib++)
+		betas[ib] = grid_node(beta_coord, 0.0, 1.0, ib, STABLE_INV_TABLE_NB);
+
+	for (ia = 0; ia < STABLE_INV_TABLE_NA; ia++) {
+		fprintf(stderr, "alfa = %1.4f\n", alfas[ia]);
+
+		for (ib = 0; ib < STABLE_INV_TABLE_NB; ib++) {
+			stable_setparams(lower, alfas[ia], betas[ib], 1.0, 0.0, 0);
+			stable_setparams(upper, alfas[ia], -betas[ib], 1.0, 0.0, 0);
+
+			/* From the center to each end, starting at the previous node */
+			for (iu = mid, y = 0; iu >= 0; iu--) {
+				u = STABLE_INV_TABLE_U_MIN + iu * STABLE_INV_TABLE_U_STEP;
+				y = solve(lower, upper, u, y);
+				table[STABLE_INV_TABLE_INDEX(ia, ib, iu)] = alfas[ia] * y;
+			}
+
+			for (iu = mid + 1, y = table[STABLE_INV_TABLE_INDEX(ia, ib, mid)] / alfas[ia];
+				 iu < STABLE_INV_TABLE_NU; iu++) {
+				u = STABLE_INV_TABLE_U_MIN + iu * STABLE_INV_TABLE_U_STEP;
+				y = solve(lower, upper, u, y);
+				table[STABLE_INV_TABLE_INDEX(ia, ib, iu)] = alfas[ia] * y;
+			}
+		}
+	}
+
+	/* Interpolation error of asinh(x) on random points of each cell */
+	srand(1234);
+
+	for (ia = 0; ia < STABLE_INV_TABLE_NA - 1; ia++) {
+		for (ib = 0; ib < STABLE_INV_TABLE_NB - 1; ib++) {
+			for (k = 0; k < checks; k++, n++) {
+				alfa = rand_in(alfas[ia], alfas[ia + 1]);
+				beta = rand_in(betas[ib], betas[ib + 1]);
+				u = rand_in(STABLE_INV_TABLE_U_MIN, -STABLE_INV_TABLE_U_MIN);
+
+				stable_setparams(lower, alfa, beta, 1.0, 0.0, 0);
+				stable_setparams(upper, alfa, -beta, 1.0, 0.0, 0);
+
+				y = asinh(stable_inv_guess_interp(table, alfa, beta, 1.0 / (1.0 + exp(-u))));
+				errors[n] = fabs(y - solve(lower, upper, u, y));
+				cell_err[ia * (STABLE_INV_TABLE_NB - 1) + ib] =
+					max(cell_err[ia * (STABLE_INV_TABLE_NB - 1) + ib], errors[n]);
+			}
+		}
+	}
+
+	if (n > 0) {
+		qsort(errors, n, sizeof(double), compare_doubles);
+		fprintf(stderr, "Error de asinh(x) en %d puntos: mediana %1.2e, 90%% %1.2e, 99%% %1.2e, maximo %1.2e\n",
+				n, errors[n / 2], errors[(int)(0.9 * (n - 1))], errors[(int)(0.99 * (n - 1))], errors[n - 1]);
+	}
+
+	printf("/* srclib/libstable/stable_inv_table.c\n *\n"
+		   " * Generated by src/gen_inv_table.c on the grid of stable_inv_table.h.\n"
+		   " * Do not edit.\n */\n\n");
+	printf("#include \"stable_inv_table.h\"\n\n");
+	printf("const double stable_inv_guess_err[(STABLE_INV_TABLE_NA - 1) * (STABLE_INV_TABLE_NB - 1)] = {\n");
+
+	for (ia = 0; ia < STABLE_INV_TABLE_NA - 1; ia++) {
+		printf("\t/* alfa = %1.4f */\n", alfas[ia]);
+
+		for (ib = 0; ib < STABLE_INV_TABLE_NB - 1; ib++)
+			printf("%s%1.2e%s", ib % 6 ? " " : "\t", cell_err[ia * (STABLE_INV_TABLE_NB - 1) + ib],
+				   ib % 6 == 5 || ib == STABLE_INV_TABLE_NB - 2 ? ",\n" : ",");
+	}
+
+	printf("};\n\n");
+	printf("const double stable_inv_guess[STABLE_INV_TABLE_NA * STABLE_INV_TABLE_NB *\n"
+		   "                             STABLE_INV_TABLE_NU] = {\n");
+
+	for (ia = 0; ia < STABLE_INV_TABLE_NA; ia++) {
+		for (ib = 0; ib < STABLE_INV_TABLE_NB; ib++) {
+			printf("\t/* alfa = %1.4f, beta = %1.4f */\n", alfas[ia], betas[ib]);
+
+			for (iu = 0; iu < STABLE_INV_TABLE_NU; iu++)
+				printf("%s%1.9e%s", iu % 5 ? " " : "\t", table[STABLE_INV_TABLE_INDEX(ia, ib, iu)],
+					   iu % 5 == 4 || iu == STABLE_INV_TABLE_NU - 1 ? ",\n" : ",");
+		}
+	}
+
+	printf("};\n");
+
+	stable_free(lower);
+	stable_free(upper);
+	free(table);
+	free(cell_err);
+	free(errors);
+
+	return 0;
+}
@@ -17,11 +17,125 @@
 
 #include <stdio.h>
 #include <sys/time.h>
+#include <time.h>
 #include <stdlib.h>
+#include <math.h>
 #include "stable_api.h"
 #include "benchmarking.h"
 #include "opencl_integ.h"
 
+/*
+ * Times the generation of batches of random variates with stable_rnd_point
+ * one at a time (the serial path), with stable_rnd on THREADS threads and, if
+ * a GPU can be initialized, with stable_rnd_gpu:
+ *
+ *     gen_randoms [THREADS]
+ *
+ * Then stable_rnd is timed on the particular cases that have a transform of
+ * their own (zones GAUSS, CAUCHY, LEVY, ALFA_1 and beta = 0), against the
+ * general Chambers-Mallows-Stuck one, and sampling by inverse transform
+ * through the quantile table of stable_rnd_table_build is timed against it,
+ * with the Kolmogorov-Smirnov distance between both samples (under about
+ * 1.36 sqrt(2 / ZONE_N) if they come from the same distribution), and with
+ * the largest difference between the variates read through stable_rnd_iter
+ * and those of stable_rnd from the same position (0 if the iterator draws
+ * from the table too). Variates of the last batch are written to stdout.
+ */
+#define ZONE_N 1000000
+#define TABLE_TOL 1e-9
+#define ITER_N 100000
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+static void zone_performance(StableDist *dist, double alfa, double beta,
+							 double *rands)
+{
+	void (*special)(const StableDist *, const double[], const double[], double[], int);
+	double start, special_ms, generic_ms;
+
+	stable_setparams(dist, alfa, beta, 1, 0, 0);
+	special = dist->stable_rnd_transform;
+
+	start = get_ms_time();
+	stable_rnd(dist, rands, ZONE_N);
+	special_ms = get_ms_time() - start;
+
+	dist->stable_rnd_transform = dist->alfa == 1 ?
+								 &stable_rnd_transform_ALFA_1 : &stable_rnd_transform_STABLE;
+
+	start = get_ms_time();
+	stable_rnd(dist, rands, ZONE_N);
+	generic_ms = get_ms_time() - start;
+
+	dist->stable_rnd_transform = special;
+
+	fprintf(stderr, "%d\t%.2lf\t%.2lf\t%.3lf\t%.3lf\n", dist->ZONE, alfa, beta,
+			generic_ms, special_ms);
+}
+
+static void table_performance(StableDist *dist, double alfa, double beta,
+							  double *rands, double *table_rands)
+{
+	struct stable_table_info info;
+	struct stable_rnd_iter *it;
+	double start, build_ms, cms_ms, table_ms, ks = 0, iter_diff = 0;
+	size_t i, j;
+
+	stable_setparams(dist, alfa, beta, 1, 0, 0);
+
+	start = get_ms_time();
+	stable_rnd(dist, rands, ZONE_N);
+	cms_ms = get_ms_time() - start;
+
+	start = get_ms_time();
+
+	if (stable_rnd_table_build(dist, TABLE_TOL) != 0 ||
+		stable_rnd_table_info(dist, &info) != 0) {
+		fprintf(stderr, "%.2lf\t%.2lf\tNo table\n", alfa, beta);
+		return;
+	}
+
+	build_ms = get_ms_time() - start;
+
+	start = get_ms_time();
+	stable_rnd(dist, table_rands, ZONE_N);
+	table_ms = get_ms_time() - start;
+
+	qsort(rands, ZONE_N, sizeof(double), compare_doubles);
+	qsort(table_rands, ZONE_N, sizeof(double), compare_doubles);
+
+	for (i = 0, j = 0; i < ZONE_N && j < ZONE_N;) {
+		if (rands[i] <= table_rands[j])
+			i++;
+		else
+			j++;
+
+		ks = max(ks, fabs((double) i - (double) j) / ZONE_N);
+	}
+
+	/* The iterator reads the same variates as stable_rnd from the table */
+	stable_rnd_seek(dist, 0, 0);
+	stable_rnd(dist, table_rands, ITER_N);
+	stable_rnd_seek(dist, 0, 0);
+
+	if ((it = stable_rnd_iter_create(dist, 0, 0)) == NULL ||
+		stable_rnd_iter_read(it, rands, ITER_N) != 0)
+		iter_diff = NAN;
+	else
+		for (i = 0; i < ITER_N; i++)
+			iter_diff = max(iter_diff, fabs(rands[i] - table_rands[i]));
+
+	stable_rnd_iter_free(it);
+
+	fprintf(stderr, "%.2lf\t%.2lf\t%.3lf\t%u\t%.1e\t%.3lf\t%.3lf\t%.5lf\t%.1e\n", alfa, beta,
+			build_ms, info.pieces + 1, info.max_error, cms_ms, table_ms, ks, iter_diff);
+}
+
 int main(int argc, const char** argv)
 {
 	double alfa = 2;
@@ -30,8 +144,12 @@ int main(int argc, const char** argv)
 	size_t num_batches = sizeof(batches) / sizeof(size_t);
 	double* cpu_rands = NULL;
 	double* gpu_rands = NULL;
+	double* zone_rands;
+	double* table_rands;
+	StableDist *zone_dist;
 	double start, end, tdiff;
-	size_t i, batch_size;
+	size_t i, j, batch_size;
+	short gpu;
 
 	StableDist *dist = stable_create(alfa, beta, 1, 0, 0);
 
@@ -40,40 +158,91 @@ int main(int argc, const char** argv)
 		return 1;
 	}
 
-	if (stable_activate_gpu(dist)) {
-		fprintf(stderr, "Couldn't initialize GPU.\n");
-		return 1;
-	}
+	if (argc > 1)
+		stable_set_THREADS(atoi(argv[1]));
+
+	gpu = stable_activate_gpu(dist) == 0;
+
+	if (!gpu)
+		fprintf(stderr, "Couldn't initialize GPU. Timing the CPU only.\n");
 
 	stable_set_absTOL(1e-20);
 	stable_set_relTOL(1.2e-10);
 	stable_rnd_seed(dist, time(NULL));
 
-	fprintf(stderr, "Count\tCPU-ms\tGPU-ms\n");
+	fprintf(stderr, "%u threads\n", stable_get_THREADS());
+	fprintf(stderr, "Count\tSerial-ms\tCPU-ms\tGPU-ms\n");
 
 	for (i = 0; i < num_batches; i++) {
 		batch_size = batches[i];
+		free(cpu_rands);
+		free(gpu_rands);
 		cpu_rands = calloc(batch_size, sizeof(double));
 		gpu_rands = calloc(batch_size, sizeof(double));
 
 		start = get_ms_time();
-		stable_rnd(dist, cpu_rands, batch_size);
+
+		for (j = 0; j < batch_size; j++)
+			cpu_rands[j] = stable_rnd_point(dist);
+
 		end = get_ms_time();
 		tdiff = end - start;
 
 		fprintf(stderr, "%zu\t%.3lf\t", batch_size, tdiff);
 
 		start = get_ms_time();
-		stable_rnd_gpu(dist, gpu_rands, batch_size);
+		stable_rnd(dist, cpu_rands, batch_size);
 		end = get_ms_time();
 		tdiff = end - start;
 
-		fprintf(stderr, "%.3lf\n", tdiff);
+		fprintf(stderr, "%.3lf\t", tdiff);
+
+		if (gpu) {
+			start = get_ms_time();
+			stable_rnd_gpu(dist, gpu_rands, batch_size);
+			end = get_ms_time();
+			tdiff = end - start;
+
+			fprintf(stderr, "%.3lf\n", tdiff);
+		} else
+			fprintf(stderr, "-\n");
 	}
 
+	fprintf(stderr, "\nZone\talfa\tbeta\tGeneric-ms\tSpecial-ms (%d variates)\n", ZONE_N);
+	zone_rands = malloc(ZONE_N * sizeof(double));
+	zone_dist = stable_copy(dist);
+
+	if (zone_rands != NULL && zone_dist != NULL) {
+		zone_performance(zone_dist, 2.0, 0.0, zone_rands);
+		zone_performance(zone_dist, 1.0, 0.0, zone_rands);
+		zone_performance(zone_dist, 0.5, 1.0, zone_rands);
+		zone_performance(zone_dist, 1.0, 0.5, zone_rands);
+		zone_performance(zone_dist, 1.0, 1.0, zone_rands);
+		zone_performance(zone_dist, 1.5, 0.0, zone_rands);
+		zone_performance(zone_dist, 0.7, 0.0, zone_rands);
+	}
+
+	fprintf(stderr, "\nalfa\tbeta\tBuild-ms\tNodes\tError\tCMS-ms\tTable-ms\tKS\tIter-diff\n");
+	table_rands = malloc(ZONE_N * sizeof(double));
+
+	if (zone_rands != NULL && table_rands != NULL && zone_dist != NULL) {
+		table_performance(zone_dist, 0.5, 0.3, zone_rands, table_rands);
+		table_performance(zone_dist, 0.8, -1.0, zone_rands, table_rands);
+		table_performance(zone_dist, 1.0, 0.5, zone_rands, table_rands);
+		table_performance(zone_dist, 1.5, 0.0, zone_rands, table_rands);
+		table_performance(zone_dist, 1.5, 1.0, zone_rands, table_rands);
+		table_performance(zone_dist, 1.9, -0.9, zone_rands, table_rands);
+	}
+
+	free(zone_rands);
+	free(table_rands);
+	stable_free(zone_dist);
+
 	for (i = 0; i < batch_size; i++)
-		printf("%.6lf\n", gpu_rands[i]);
+		printf("%.6lf\n", gpu ? gpu_rands[i] : cpu_rands[i]);
 
+	free(cpu_rands);
+	free(gpu_rands);
 	stable_free(dist);
 	return 0;
 }
@@ -62,6 +62,41 @@ static void _measure_performance(StableDist *dist, double* x, size_t nx, double
 	printf("%.3f %.3f\t| %.3f |\n", alfa, beta, (gpu_end - gpu_start) / nx);
 }
 
+/* Quantiles of a grid in (0, 1) one at a time and with the batch stable_inv,
+   which solves them in order, each one from its neighbour */
+static void _measure_batch(StableDist *dist, size_t nq, double alfa, double beta,
+						   double *point_total, double *batch_total)
+{
+	size_t i;
+	double start, point_ms, batch_ms;
+	double *q, *inv;
+
+	q = calloc(nq, sizeof(double));
+	inv = calloc(nq, sizeof(double));
+
+	for (i = 0; i < nq; i++)
+		q[i] = (i + 0.5) / nq;
+
+	start = get_ms_time();
+
+	for (i = 0; i < nq; i++)
+		inv[i] = stable_inv_point(dist, q[i], NULL);
+
+	point_ms = get_ms_time() - start;
+
+	start = get_ms_time();
+	stable_inv(dist, q, nq, inv, NULL);
+	batch_ms = get_ms_time() - start;
+
+	*point_total += point_ms;
+	*batch_total += batch_ms;
+
+	printf("%.3f %.3f\t| %.4f | %.4f |\n", alfa, beta, point_ms / nq, batch_ms / nq);
+
+	free(q);
+	free(inv);
+}
+
 static void fill(double* array, double begin, double end, size_t size)
 {
 	size_t i;
@@ -84,6 +119,7 @@ int main(int argc, char** argv)
 	StableDist *dist;
 	int ai, bi;
 	double cpu_total;
+	double point_total = 0, batch_total = 0;
 	struct opencl_profile profile;
 	double ms_per_point;
 	short enable_cpu = 0;
@@ -131,6 +167,20 @@ int main(int argc, char** argv)
 		}
 	}
 
+	if (enable_cpu) {
+		fprintf(stdout, "α     β\t\t| point | batch | (ms per quantile of %zu)\n", evpoints_len);
+
+		for (ai = 0; ai < alfas_len; ai++) {
+			for (bi = 0; bi < betas_len; bi++) {
+				stable_setparams(dist, alfas[ai], betas[bi], sigma, mu, 0);
+				_measure_batch(dist, evpoints_len, alfas[ai], betas[bi], &point_total, &batch_total);
+			}
+		}
+
+		printf("Batch: %.2fx the quantiles per second of stable_inv_point.\n",
+			   point_total / batch_total);
+	}
+
 	fflush(stdout);
 
 	if (stable_activate_gpu(dist)) {
@@ -8,6 +8,19 @@
  *     - Different precisions
  *     - Different number of threads of execution
  *
+ * With FUNC=3 it compares instead the scheduling of evaluation points among
+ * threads (CHUNK_SIZE) on heavy-tailed samples drawn from the distribution,
+ * where the cost of each point differs a lot between the center and the tails.
+ * With FUNC=4 it reports the build cost, memory and accuracy of the tabulated
+ * PDF and CDF (stable_pdf_table, stable_cdf_table) and their speedup.
+ * With FUNC=5 it reports the share of random samples evaluated with the series
+ * around xi and on the tails instead of the numerical integration, and the
+ * speedup over integrating at every point.
+ * With FUNC=6 it reports the time per point of the numerical integration with
+ * the GSL rules and with the in-library GK21 integrator (STABLE_GK21).
+ * With FUNC=7 it compares the quantiles of stable_inv with those answered from
+ * the tabulated CDF by stable_inv_table, with and without the Newton polish.
+ *
  * Each computation is repeated several times to obtain confidence intervals on
  * Libstable performance.
  *
@@ -40,9 +53,430 @@
 #include <math.h>
 
 #include "stable_api.h"
+#include "stable_series.h"
 
 #include <sys/time.h>
 #include <time.h>
+#include <pthread.h>
+
+static int compare_doubles(const void *a, const void *b)
+{
+	double da = *(const double *) a, db = *(const double *) b;
+
+	return (da > db) - (da < db);
+}
+
+static double time_batch(StableDist *dist,
+						 void (*func)(StableDist *, const double *, const int, double *, double *),
+						 const double *x, int Nx, double *out, double *err, int Ntest)
+{
+	struct timeval tp_1, tp_2;
+	double t = 0;
+	int kt;
+
+	for (kt = 0; kt < Ntest; kt++) {
+		gettimeofday(&tp_1, NULL);
+		(func)(dist, x, Nx, out, err);
+		gettimeofday(&tp_2, NULL);
+		t += tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+	}
+
+	return t / Ntest;
+}
+
+/* Static partition as the library made it before the worker pool: one thread
+ * per contiguous block of Nx / threads points, each evaluating its block alone
+ * on its own copy of the distribution (configured with a single thread, so the
+ * batch functions run inline instead of through the pool). */
+struct static_block {
+	pthread_t thread;
+	StableDist *dist;
+	void (*func)(StableDist *, const double *, const int, double *, double *);
+	const double *x;
+	double *out;
+	double *err;
+	int Nx;
+};
+
+static void *static_block_run(void *ptr_args)
+{
+	struct static_block *block = (struct static_block *) ptr_args;
+
+	(block->func)(block->dist, block->x, block->Nx, block->out, block->err);
+
+	return NULL;
+}
+
+static double time_static(StableDist *dist,
+						  void (*func)(StableDist *, const double *, const int, double *, double *),
+						  const double *x, int Nx, double *out, double *err, int Ntest)
+{
+	struct timeval tp_1, tp_2;
+	struct stable_config cfg;
+	struct static_block *blocks;
+	int threads = stable_get_THREADS(), size = (Nx + threads - 1) / threads, k, kt, begin;
+	double t = 0;
+
+	blocks = (struct static_block *)calloc(threads, sizeof(struct static_block));
+
+	for (k = 0; k < threads; k++) {
+		begin = min(k * size, Nx);
+		blocks[k].dist = stable_copy(dist);
+		stable_get_config(blocks[k].dist, &cfg);
+		cfg.THREADS = 1;
+		stable_set_config(blocks[k].dist, &cfg);
+		blocks[k].func = func;
+		blocks[k].x = x + begin;
+		blocks[k].out = out + begin;
+		blocks[k].err = err + begin;
+		blocks[k].Nx = min(begin + size, Nx) - begin;
+	}
+
+	for (kt = 0; kt < Ntest; kt++) {
+		gettimeofday(&tp_1, NULL);
+
+		for (k = 0; k < threads; k++)
+			pthread_create(&blocks[k].thread, NULL, static_block_run, &blocks[k]);
+
+		for (k = 0; k < threads; k++)
+			pthread_join(blocks[k].thread, NULL);
+
+		gettimeofday(&tp_2, NULL);
+		t += tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+	}
+
+	for (k = 0; k < threads; k++)
+		stable_free(blocks[k].dist);
+
+	free(blocks);
+
+	return t / Ntest;
+}
+
+/* Times stable_pdf and stable_cdf on random samples of the distribution, both
+ * as drawn and sorted (tails at both ends of the array), with the static
+ * partition in contiguous blocks and with dynamic chunks of several sizes. */
+static void scheduling_performance(StableDist *dist, long int threads)
+{
+	double alfa[] = {0.5, 0.8, 1.25, 1.75},
+		   beta[] = {0.0, 0.9};
+	unsigned int chunks[] = {0, 1, 8, 64};
+	int Na = 4, Nb = 2, Nc = 4, Nx = 20000, Ntest = 5, ka, kb, kc, ks, n;
+	double *x, *out, *err, t_static, t;
+	void (*func)(StableDist *, const double *, const int, double *, double *);
+
+	x   = (double *)malloc(Nx * sizeof(double));
+	out = (double *)malloc(Nx * sizeof(double));
+	err = (double *)malloc(Nx * sizeof(double));
+
+	printf("\n%ld hilos, %d puntos. Tiempo medio (s) y aceleracion respecto a reparto estatico\n", threads, Nx);
+	printf("FUNC ALFA  BETA  ORDEN     ESTATICO");
+
+	for (kc = 0; kc < Nc; kc++)
+		if (chunks[kc] == 0) printf("          CHUNK=auto");
+		else printf("          CHUNK=%-4u", chunks[kc]);
+
+	printf("\n");
+
+	for (n = 1; n <= 2; n++) {
+		func = n == 1 ? &stable_pdf : &stable_cdf;
+
+		for (ka = 0; ka < Na; ka++) {
+			for (kb = 0; kb < Nb; kb++) {
+				stable_setparams(dist, alfa[ka], beta[kb], 1.0, 0.0, 0);
+				stable_rnd_seed(dist, 1234);
+				stable_rnd(dist, x, Nx);
+
+				for (ks = 0; ks < 2; ks++) {
+					if (ks == 1)
+						qsort(x, Nx, sizeof(double), compare_doubles);
+
+					t_static = time_static(dist, func, x, Nx, out, err, Ntest);
+
+					printf("%4d %1.2lf % 1.2lf %-8s %1.4e", n, alfa[ka], beta[kb],
+						   ks ? "ordenado" : "aleat.", t_static);
+
+					for (kc = 0; kc < Nc; kc++) {
+						stable_set_CHUNK_SIZE(chunks[kc]);
+						t = time_batch(dist, func, x, Nx, out, err, Ntest);
+						printf("  %1.4e (x%1.2lf)", t, t_static / t);
+					}
+
+					printf("\n");
+				}
+			}
+		}
+	}
+
+	stable_set_CHUNK_SIZE(0);
+
+	free(x);
+	free(out);
+	free(err);
+}
+
+/* Builds the tabulated PDF and CDF at several tolerances and compares them
+ * with the numerical integration on random samples of the distribution. */
+static void table_performance(StableDist *dist, long int threads)
+{
+	double alfa[] = {0.5, 0.8, 1.0, 1.25, 1.75},
+		   beta[] = {0.0, 0.9},
+		   tol[] = {1e-6, 1e-8, 1e-10};
+	int Na = 5, Nb = 2, Nt = 3, Nx = 20000, Ntest = 5, ka, kb, kt, n, i;
+	double *x, *exact, *tab, *err, t_exact, t_tab, e, emax;
+	struct stable_table_info info;
+	void (*func)(StableDist *, const double *, const int, double *, double *);
+	void (*tfunc)(StableDist *, const double *, const int, double *, double *);
+
+	x     = (double *)malloc(Nx * sizeof(double));
+	exact = (double *)malloc(Nx * sizeof(double));
+	tab   = (double *)malloc(Nx * sizeof(double));
+	err   = (double *)malloc(Nx * sizeof(double));
+
+	printf("\n%ld hilos, %d puntos. Tabla: construccion, memoria y error; tiempo medio (s) de evaluacion\n", threads, Nx);
+	printf("FUNC ALFA  BETA  RELTOL    CONSTR.(s) PIEZAS MEMORIA   ERR.CERT.  ERR.MEDIDO   INTEGRACION  TABLA\n");
+
+	for (n = 1; n <= 2; n++) {
+		func = n == 1 ? &stable_pdf : &stable_cdf;
+		tfunc = n == 1 ? &stable_pdf_table : &stable_cdf_table;
+
+		for (ka = 0; ka < Na; ka++) {
+			for (kb = 0; kb < Nb; kb++) {
+				stable_setparams(dist, alfa[ka], beta[kb], 1.0, 0.0, 0);
+				stable_rnd_seed(dist, 1234);
+				stable_rnd(dist, x, Nx);
+
+				for (kt = 0; kt < Nt; kt++) {
+					stable_set_relTOL(tol[kt]);
+					t_exact = time_batch(dist, func, x, Nx, exact, err, 1);
+
+					stable_table_free(dist);
+
+					if (stable_table_build(dist, n == 1 ? PDF : CDF, tol[kt]) != 0 ||
+						stable_table_info(dist, n == 1 ? PDF : CDF, &info) != 0) {
+						printf("%4d %1.2lf % 1.2lf %1.2e  sin tabla\n", n, alfa[ka], beta[kb], tol[kt]);
+						continue;
+					}
+
+					t_tab = time_batch(dist, tfunc, x, Nx, tab, err, Ntest);
+
+					for (i = 0, emax = 0; i < Nx; i++) {
+						e = fabs(tab[i] - exact[i]) / (exact[i] > 1e-300 ? exact[i] : 1e-300);
+
+						if (e > emax)
+							emax = e;
+					}
+
+					printf("%4d %1.2lf % 1.2lf %1.2e  %1.4e %6u %8lu  %1.2e   %1.2e     %1.4e  %1.4e (x%1.1lf)\n",
+						   n, alfa[ka], beta[kb], tol[kt], info.build_time, info.pieces,
+						   (unsigned long) info.memory, info.max_error, emax, t_exact, t_tab,
+						   t_exact / t_tab);
+				}
+			}
+		}
+	}
+
+	stable_table_free(dist);
+
+	free(x);
+	free(exact);
+	free(tab);
+	free(err);
+}
+
+/* Share of random samples where the series around xi or the tail expansions
+ * replace the numerical integration, and time with and without them. */
+static void series_performance(StableDist *dist, long int threads)
+{
+	double alfa[] = {0.5, 0.75, 0.9, 1.0, 1.1, 1.25, 1.5, 1.75, 1.95},
+		   beta[] = {0.0, 0.5, 1.0};
+	int Na = 9, Nb = 3, Nx = 20000, Ntest = 5, ka, kb, n, i, f, mode;
+	unsigned int ncenter, ntails;
+	double *x, *out, *err, t_integ, t, xxi, v, e, tol = stable_get_relTOL();
+	void (*func)(StableDist *, const double *, const int, double *, double *);
+
+	x   = (double *)malloc(Nx * sizeof(double));
+	out = (double *)malloc(Nx * sizeof(double));
+	err = (double *)malloc(Nx * sizeof(double));
+
+	mode = stable_get_EVAL_MODE();
+
+	printf("\n%ld hilos, %d puntos, RELTOL %1.2e. Puntos sin integracion numerica y tiempo medio (s)\n",
+		   threads, Nx, tol);
+	printf("FUNC ALFA  BETA   CENTRO   COLAS    INTEGRACION  SERIES\n");
+
+	for (n = 1; n <= 2; n++) {
+		func = n == 1 ? &stable_pdf : &stable_cdf;
+		f = n == 1 ? PDF : CDF;
+
+		for (ka = 0; ka < Na; ka++) {
+			for (kb = 0; kb < Nb; kb++) {
+				stable_setparams(dist, alfa[ka], beta[kb], 1.0, 0.0, 0);
+				stable_rnd_seed(dist, 1234);
+				stable_rnd(dist, x, Nx);
+
+				for (i = 0, ncenter = 0, ntails = 0; i < Nx; i++) {
+					xxi = x[i] - dist->xi;
+
+					if (dist->ZONE == STABLE &&
+						stable_center_series_point(&dist->center[f], xxi, tol, &v, &e))
+						ncenter++;
+					else if ((dist->ZONE == STABLE || dist->ZONE == ALFA_1) &&
+							 stable_tail_series_point(&dist->tail[f][xxi < 0], fabs(xxi), tol, &v, &e))
+						ntails++;
+				}
+
+				stable_set_EVAL_MODE(STABLE_EVAL_INTEG);
+				t_integ = time_batch(dist, func, x, Nx, out, err, Ntest);
+				stable_set_EVAL_MODE(mode);
+				t = time_batch(dist, func, x, Nx, out, err, Ntest);
+
+				printf("%4d %1.2lf % 1.2lf  %6.2lf%%  %6.2lf%%  %1.4e  %1.4e (x%1.2lf)\n",
+					   n, alfa[ka], beta[kb], 100.0 * ncenter / Nx, 100.0 * ntails / Nx,
+					   t_integ, t, t_integ / t);
+			}
+		}
+	}
+
+	free(x);
+	free(out);
+	free(err);
+}
+
+/* Time per point of the numerical integration (no series) with the default
+ * GSL rules and with STABLE_GK21, on random samples of the distribution. */
+static void gk21_performance(StableDist *dist, long int threads)
+{
+	double alfa[] = {0.5, 0.8, 1.0, 1.25, 1.5, 1.9},
+		   beta[] = {0.0, 0.5, 1.0},
+		   tol[] = {1e-6, 1e-8, 1e-10};
+	int Na = 6, Nb = 3, Nt = 3, Nx = 5000, Ntest = 3, ka, kb, kt, n, method, mode;
+	double *x, *out, *err, t_gsl, t;
+	void (*func)(StableDist *, const double *, const int, double *, double *);
+
+	x   = (double *)malloc(Nx * sizeof(double));
+	out = (double *)malloc(Nx * sizeof(double));
+	err = (double *)malloc(Nx * sizeof(double));
+
+	method = stable_get_METHOD();
+	mode = stable_get_EVAL_MODE();
+	stable_set_EVAL_MODE(STABLE_EVAL_INTEG);
+
+	printf("\n%ld hilos, %d puntos. Tiempo medio por punto (us)\n", threads, Nx);
+	printf("FUNC ALFA  BETA  RELTOL    GSL        GK21\n");
+
+	for (n = 1; n <= 2; n++) {
+		func = n == 1 ? &stable_pdf : &stable_cdf;
+
+		for (ka = 0; ka < Na; ka++) {
+			for (kb = 0; kb < Nb; kb++) {
+				stable_setparams(dist, alfa[ka], beta[kb], 1.0, 0.0, 0);
+				stable_rnd_seed(dist, 1234);
+				stable_rnd(dist, x, Nx);
+
+				for (kt = 0; kt < Nt; kt++) {
+					stable_set_relTOL(tol[kt]);
+
+					stable_set_METHOD(method);
+					t_gsl = time_batch(dist, func, x, Nx, out, err, Ntest);
+					stable_set_METHOD(STABLE_GK21);
+					t = time_batch(dist, func, x, Nx, out, err, Ntest);
+
+					printf("%4d %1.2lf % 1.2lf %1.2e  %9.3lf  %9.3lf (x%1.2lf)\n",
+						   n, alfa[ka], beta[kb], tol[kt],
+						   t_gsl / Nx * 1e6, t / Nx * 1e6, t_gsl / t);
+				}
+			}
+		}
+	}
+
+	stable_set_METHOD(method);
+	stable_set_EVAL_MODE(mode);
+
+	free(x);
+	free(out);
+	free(err);
+}
+
+/* Quantiles of q log-spaced towards 0 and 1 with stable_inv and with
+ * stable_inv_table, whose first call includes building the CDF table. The
+ * error is that of the CDF at the quantile, relative to min(q, 1 - q). */
+static void inv_table_performance(StableDist *dist, long int threads)
+{
+	double alfa[] = {0.5, 0.8, 1.0, 1.25, 1.5, 1.9},
+		   beta[] = {0.0, 0.5, 1.0};
+	int Na = 6, Nb = 3, Nq = 2000, ka, kb, i, polish;
+	double *q, *inv, *err, *cdf, t_inv, t_build, t, e, emax;
+	struct timeval tp_1, tp_2;
+
+	q   = (double *)malloc(Nq * sizeof(double));
+	inv = (double *)malloc(Nq * sizeof(double));
+	err = (double *)malloc(Nq * sizeof(double));
+	cdf = (double *)malloc(Nq * sizeof(double));
+
+	for (i = 0; i < Nq; i++)
+		q[i] = 1.0 / (1.0 + exp(20.0 - 40.0 * (i + 0.5) / Nq));
+
+	printf("\n%ld hilos, %d cuantiles. Tiempo medio por cuantil (us) y error relativo maximo de q\n", threads, Nq);
+	printf("ALFA  BETA   STABLE_INV            CONSTR.(ms) TABLA                 TABLA+NEWTON\n");
+
+	for (ka = 0; ka < Na; ka++) {
+		for (kb = 0; kb < Nb; kb++) {
+			stable_setparams(dist, alfa[ka], beta[kb], 1.0, 0.0, 0);
+			stable_table_free(dist);
+			printf("%1.2lf % 1.2lf", alfa[ka], beta[kb]);
+
+			gettimeofday(&tp_1, NULL);
+			stable_inv(dist, q, Nq, inv, err);
+			gettimeofday(&tp_2, NULL);
+			t_inv = tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+
+			for (polish = -1; polish <= 1; polish++) {
+				if (polish >= 0) {
+					gettimeofday(&tp_1, NULL);
+					stable_inv_table(dist, q, Nq, inv, err, polish);
+					gettimeofday(&tp_2, NULL);
+					t = tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+				} else
+					t = t_inv;
+
+				stable_cdf(dist, inv, Nq, cdf, err);
+
+				for (i = 0, emax = 0; i < Nq; i++) {
+					e = q[i] > 0.5 ? fabs((1.0 - cdf[i]) - (1.0 - q[i])) / (1.0 - q[i]) :
+						fabs(cdf[i] - q[i]) / q[i];
+
+					if (e > emax)
+						emax = e;
+				}
+
+				/* The first call of stable_inv_table builds the table */
+				if (polish == 0) {
+					t_build = t;
+					gettimeofday(&tp_1, NULL);
+					stable_inv_table(dist, q, Nq, inv, err, 0);
+					gettimeofday(&tp_2, NULL);
+					t = tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+					printf("  %9.3lf", (t_build - t) * 1e3);
+				}
+
+				printf("  %9.3lf %1.2e", t / Nq * 1e6, emax);
+
+				if (polish >= 0)
+					printf(" (x%1.1lf)", t_inv / t);
+			}
+
+			printf("\n");
+		}
+	}
+
+	stable_table_free(dist);
+
+	free(q);
+	free(inv);
+	free(err);
+	free(cdf);
+}
 
 int main(int argc, char *argv[])
 {
@@ -84,7 +518,7 @@ int main(int argc, char *argv[])
 	void (*func)(StableDist *, const double *, const int, double *, double *);
 
 	if (argc < 3) {
-		printf("Uso: stable_performance FUNC THREADS\n     FUNC=1: PDF\n     FUNC=2: CDF\n     FUNC=0: Ambas\n");
+		printf("Uso: stable_performance FUNC THREADS\n     FUNC=1: PDF\n     FUNC=2: CDF\n     FUNC=0: Ambas\n     FUNC=3: Reparto de puntos entre hilos\n     FUNC=4: PDF y CDF tabuladas\n     FUNC=5: Desarrollos en serie frente a integracion\n     FUNC=6: Integrador GK21 frente a GSL\n     FUNC=7: Cuantiles con la CDF tabulada\n");
 		exit(1);
 	} else {
 		n = atoi(argv[1]);
@@ -120,6 +554,37 @@ int main(int argc, char *argv[])
 	stable_set_METHOD(STABLE_QNG);
 	stable_set_METHOD2(STABLE_QAG2);
 
+	if (n == 3) {
+		scheduling_performance(dist, threads);
+		stable_free(dist);
+		return 0;
+	}
+
+	if (n == 4) {
+		table_performance(dist, threads);
+		stable_free(dist);
+		return 0;
+	}
+
+	if (n == 5) {
+		stable_set_relTOL(1e-8);
+		series_performance(dist, threads);
+		stable_free(dist);
+		return 0;
+	}
+
+	if (n == 6) {
+		gk21_performance(dist, threads);
+		stable_free(dist);
+		return 0;
+	}
+
+	if (n == 7) {
+		inv_table_performance(dist, threads);
+		stable_free(dist);
+		return 0;
+	}
+
 	printf("\n\n          FUNCION     RELTOL     ALFA   BETA   INTERVALO\n");
 
 	if (n == 0) {
@@ -129,7 +594,7 @@ int main(int argc, char *argv[])
 		n0 = n;
 		n1 = n;
 	} else {
-		printf("n debe ser 0, 1 o 2\n");
+		printf("n debe ser 0, 1, 2, 3, 4 o 5\n");
 		exit(3);
 	}
 
@@ -6,6 +6,11 @@
  *     - A finite set of points in the alpha-beta parameter space.
  *     - A log-scaled swipe on abscissae axis.
  *
+ * With a third argument set to 1, each evaluation is repeated with numerical
+ * integration at every point (STABLE_EVAL_INTEG), and the largest relative
+ * difference and the time of both evaluations are printed, so the methods
+ * used instead of the integration can be checked against it.
+ *
  * Copyright (C) 2013. Javier Royuela del Val
  *                     Federico Simmross Wattenberg
  *
@@ -46,6 +51,7 @@ int main(int argc, char *argv[])
 		   delta = 0;
 
 	int    THREADS = 16;
+	int    eval_mode = stable_get_EVAL_MODE();
 	double tol = 1.2e-14;
 	double atol = 1e-50;
 
@@ -61,13 +67,14 @@ int main(int argc, char *argv[])
 	unsigned int Nx0[]   = {  0,   900,     1620,        2196,     3220,  3796, 4516};
 	double xD[] = {     1, 0.125, 0.015625, 0.001953125, 0.015625, 0.125,   1};
 
-	double *pdf, *err;
+	double *pdf, *err, *ref, *ref_err, diff, dmax;
+	int compare = 0, kmax;
 	StableDist *dist = NULL;
 	int i = 1, j, k;
 	void(*func)(StableDist *, const double *, const int,
 				double *, double *);
-	struct timeval t_1, t_2/*,tp_1,tp_2*/;
-	double t, tpdf;
+	struct timeval t_1, t_2, tp_1, tp_2;
+	double t, tpdf, tint;
 
 	char name[256], nameerr[256]/*,nametiempos[256]*/;
 	FILE * f;
@@ -76,12 +83,15 @@ int main(int argc, char *argv[])
 	FILE * flog;
 	FILE * finteg;
 
-	if (argc != 3) {
-		printf("Uso: stable_precision FUNCION RELTOL\n");
+	if (argc != 3 && argc != 4) {
+		printf("Uso: stable_precision FUNCION RELTOL [COMPARAR]\n");
 		exit(1);
 	} else {
 		tol = atof(argv[2]);
 		n   = atoi(argv[1]);
+
+		if (argc == 4)
+			compare = atoi(argv[3]);
 	}
 
 	for (i = 0; i < Ndiv; i++) {
@@ -101,6 +111,8 @@ int main(int argc, char *argv[])
 	*/
 	pdf = (double*)malloc(Nx * Nb * sizeof(double));
 	err = (double*)malloc(Nx * Nb * sizeof(double));
+	ref = (double*)malloc(Nx * sizeof(double));
+	ref_err = (double*)malloc(Nx * sizeof(double));
 
 	if (n == 1) {
 		func = &stable_pdf;
@@ -152,9 +164,34 @@ int main(int argc, char *argv[])
 			stable_setparams(dist, alfa[j], beta[i], gamma, delta, P);
 			//          gettimeofday(&tp_1,NULL);
 
+			gettimeofday(&tp_1, NULL);
 			(func)(dist, (const double *)x, Nx, pdf + i * Nx, err + i * Nx);
+			gettimeofday(&tp_2, NULL);
 			printf("        -> Alfa = %lf, Beta = %lf, %d points OK <-\n",
 				   alfa[j], beta[i], Nx);
+
+			if (compare) {
+				tpdf = tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+
+				stable_set_EVAL_MODE(STABLE_EVAL_INTEG);
+				gettimeofday(&tp_1, NULL);
+				(func)(dist, (const double *)x, Nx, ref, ref_err);
+				gettimeofday(&tp_2, NULL);
+				stable_set_EVAL_MODE(eval_mode);
+				tint = tp_2.tv_sec - tp_1.tv_sec + (tp_2.tv_usec - tp_1.tv_usec) / 1000000.0;
+
+				for (k = 0, dmax = 0, kmax = 0; k < Nx; k++) {
+					diff = fabs(pdf[i * Nx + k] - ref[k]) / max(fabs(ref[k]), 1e-300);
+
+					if (diff > dmax) {
+						dmax = diff;
+						kmax = k;
+					}
+				}
+
+				printf("           Dif. relativa max. %1.2e (x = %1.3lf), tiempo %1.3lf s, integracion %1.3lf s (x%1.2lf)\n",
+					   dmax, x[kmax], tpdf, tint, tint / tpdf);
+			}
 			//          gettimeofday(&tp_2,NULL);
 			//          tpdf=tp_2.tv_sec-tp_1.tv_sec+(tp_2.tv_usec-tp_1.tv_usec)/1000000.0;
 			//          fprintf(ftiempos,"%1.2lf %1.2lf %1.16lf %1.16lf\n",alfa[j],beta[i],tpdf,(double)Nx/tpdf);
@@ -222,16 +222,20 @@ static void _stable_print_profileinfo(struct opencl_profile *prof)
 
 static void _stable_clinteg_prepare_kernel_data(struct stable_info* info, StableDist* dist)
 {
+	struct stable_config cfg;
+
+	stable_get_config(dist, &cfg);
+
 	info->k1 = dist->k1;
 	info->alfa = dist->alfa;
 	info->alfainvalfa1 = dist->alfainvalfa1;
 	info->beta = dist->beta;
-	info->THETA_TH = stable_get_THETA_TH();
+	info->THETA_TH = cfg.THETA_TH;
 	info->theta0 = dist->theta0;
 	info->xi = dist->xi;
 	info->mu_0 = dist->mu_0;
 	info->sigma = dist->sigma;
-	info->xxi_th = stable_get_XXI_TH();
+	info->xxi_th = cfg.XXI_TH;
 	info->c2_part = dist->c2_part;
 	info->xi_coef = (exp(lgamma(1 + 1 / dist->alfa))) / (M_PI * pow(1 + dist->xi * dist->xi, 1 / (2 * dist->alfa)));
 	info->c1 = dist->c1;
@@ -32,26 +32,28 @@
 #include "stable_api.h"
 //#include "stable_common.h"
 #include "stable_integration.h"
+#include "stable_kernels.h"
 
 #include "methods.h"
-#include <pthread.h>
+#include "stable_pool.h"
 
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define SUBS_def 2
 
 double stable_cdf_g1(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, V, aux;
 
-	aux = (dist->beta_ * theta + M_PI_2) / cos(theta);
-	V = sin(theta) * aux / dist->beta_ + log(aux) + dist->k1;
+	aux = (ctx->beta_ * theta + M_PI_2) / cos(theta);
+	V = sin(theta) * aux / ctx->beta_ + log(aux) + dist->k1;
 
 #ifdef DEBUG
 	integ_eval++;
 #endif
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 	//Taylor: exp(-x) ~ 1-x en x ~ 0
 	//Si g < 1.52e-8 -> exp(-g) = (1-g) con precision double.
@@ -69,11 +71,12 @@ double stable_cdf_g1(double theta, void *args)
 
 double stable_cdf_g2(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, cos_theta, aux, V;
 
 	cos_theta = cos(theta);
-	aux = (dist->theta0_ + theta) * dist->alfa;
+	aux = (ctx->theta0_ + theta) * dist->alfa;
 	V = log(cos_theta / sin(aux)) * dist->alfainvalfa1 +
 		+ log(cos(aux - theta) / cos_theta) + dist->k1;
 
@@ -81,7 +84,7 @@ double stable_cdf_g2(double theta, void *args)
 	integ_eval++;
 #endif
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 	//Taylor: exp(-x) ~ 1-x en x ~ 0
 	//Si g < 1.52e-8 -> exp(-g) = (1-g) con precision double.
@@ -99,7 +102,8 @@ double stable_cdf_g2(double theta, void *args)
 
 double stable_cdf_g(double theta, void *args)
 {
-	StableDist * dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 
 	if (dist->ZONE == ALFA_1)
 		return stable_cdf_g1(theta, args);
@@ -111,13 +115,14 @@ double stable_cdf_g(double theta, void *args)
 
 double stable_cdf_g_aux1(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, V, aux;
 
-	aux = (dist->beta_ * theta + M_PI_2) / cos(theta);
-	V = sin(theta) * aux / dist->beta_ + log(aux) + dist->k1;
+	aux = (ctx->beta_ * theta + M_PI_2) / cos(theta);
+	V = sin(theta) * aux / ctx->beta_ + log(aux) + dist->k1;
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 #ifdef DEBUG
 	integ_eval++;
@@ -130,15 +135,16 @@ double stable_cdf_g_aux1(double theta, void *args)
 
 double stable_cdf_g_aux2(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, cos_theta, aux, V;
 
 	cos_theta = cos(theta);
-	aux = (dist->theta0_ + theta) * dist->alfa;
+	aux = (ctx->theta0_ + theta) * dist->alfa;
 	V = log(cos_theta / sin(aux)) * dist->alfainvalfa1 +
 		+ log(cos(aux - theta) / cos_theta) + dist->k1;
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 #ifdef DEBUG
 	integ_eval++;
@@ -151,7 +157,8 @@ double stable_cdf_g_aux2(double theta, void *args)
 
 double stable_cdf_g_aux(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 
 	if (dist->ZONE == ALFA_1)
 		return stable_cdf_g_aux1(theta, args);
@@ -159,28 +166,37 @@ double stable_cdf_g_aux(double theta, void *args)
 		return stable_cdf_g_aux2(theta, args);
 }
 
-void * thread_init_cdf(void *ptr_args)
+/* Node kernel (stable_kernels.h), same values as stable_cdf_g2 */
+void stable_cdf_g2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n)
 {
-	StableArgsCdf *args = (StableArgsCdf *)ptr_args;
-	int counter_ = 0;
+	double v;
+	int i;
+
+	stable_g_aux2_nodes(ctx, theta, g, n);
 
-	while (counter_ < args->Nx) {
-		args->cdf[counter_] = (*(args->ptr_funcion))(args->dist, args->x[counter_],
-							  &(args->err[counter_]));
-		counter_++;
+	for (i = 0; i < n; i++) {
+		v = stable_vm_exp(g[i]);
+		g[i] = v < 1.522e-8 ? 1.0 - v : stable_vm_exp(-v);
 	}
+}
 
-	pthread_exit(NULL);
+void thread_init_cdf(struct stable_worker *worker, void *ptr_args)
+{
+	StableArgsCdf *args = (StableArgsCdf *)ptr_args;
+	int counter_, end;
+
+	while (stable_pool_take(worker, &args->next, args->Nx, &counter_, &end)) {
+		for (; counter_ < end; counter_++)
+			args->cdf[counter_] = (*(args->ptr_funcion))(args->dist, args->x[counter_],
+								  &(args->err[counter_]));
+	}
 }
 
 void stable_cdf(StableDist *dist, const double x[], const int Nx, double *cdf, double *err)
 {
-	int Nx_thread[THREADS],
-		initpoint[THREADS],
-		k, flag = 0;
-	void *status;
-	pthread_t threads[THREADS];
-	StableArgsCdf args[THREADS];
+	int flag = 0;
+	struct stable_config cfg;
+	StableArgsCdf args;
 
 	/* Si no se quiere introduce el puntero para el error, se crea*/
 	if (err == NULL) {
@@ -188,48 +204,18 @@ void stable_cdf(StableDist *dist, const double x[], const int Nx, double *cdf, d
 		err = malloc(Nx * sizeof(double));
 	}
 
-	/* Reparto de los puntos de evaluacion entre los hilos disponibles */
-
-	Nx_thread[0] = Nx / THREADS;
-
-	if (0 < Nx % THREADS) Nx_thread[0]++;
-
-	initpoint[0] = 0;
-
-	for (k = 1; k < THREADS; k++) {
-		Nx_thread[k] = Nx / THREADS;
-
-		if (k < Nx % THREADS) Nx_thread[k]++;
-
-		initpoint[k] = initpoint[k - 1] + Nx_thread[k - 1];
-	}
-
-	/* Creacion de los hilos, pasando a cada uno una copia de la distribucion */
-
-	for (k = 0; k < THREADS; k++) {
-		args[k].ptr_funcion = dist->stable_cdf_point;
-		args[k].dist = stable_copy(dist);
-		args[k].cdf  = cdf + initpoint[k];
-		args[k].x    = x + initpoint[k];
-		args[k].Nx   = Nx_thread[k];
-		args[k].err  = err + initpoint[k];
-
-		if (pthread_create(&threads[k], NULL, thread_init_cdf, (void *)&args[k])) {
-			perror("Error en la creacion de hilo");
-
-			if (flag == 1) free(err);
-
-			return;
-		}
-	}
-
-	/* Esperar a finalizacion de todos los hilos */
-	for (k = 0; k < THREADS; k++)
-		pthread_join(threads[k], &status);
+	/* Los hilos del pool se reparten los puntos de evaluacion, que comparten la
+	   misma distribucion */
+	args.ptr_funcion = dist->stable_cdf_point;
+	args.dist = dist;
+	args.cdf  = cdf;
+	args.x    = x;
+	args.Nx   = Nx;
+	args.err  = err;
+	args.next = 0;
 
-	/* Liberar las copias de la distribucion realizadas */
-	for (k = 0; k < THREADS; k++)
-		stable_free(args[k].dist);
+	stable_get_config(dist, &cfg);
+	stable_pool_run(cfg.THREADS, thread_init_cdf, &args);
 
 	if (flag == 1) free(err);
 }
@@ -239,36 +225,38 @@ void stable_cdf(StableDist *dist, const double x[], const int Nx, double *cdf, d
 /******************************************************************************/
 
 double
-stable_integration_cdf(StableDist *dist, double(*integrando)(double, void*),
+stable_integration_cdf(StableEvalCtx *ctx, double(*integrando)(double, void*),
 					   double(*auxiliar)(double, void*), double *err)
 {
+	const StableDist *dist = ctx->dist;
+	const struct stable_config *cfg = &ctx->cfg;
 	int k, warnz[SUBS_def], method_[SUBS_def];
 	double cdf = 0, cdf1 = 0, err1 = 0;
 	double theta[SUBS_def + 1], g[SUBS_def + 1];
 
-	theta[0] = -dist->theta0_ + THETA_TH;
-	g[0] = stable_cdf_g(theta[0], (void*)dist);
+	theta[0] = -ctx->theta0_ + cfg->THETA_TH;
+	g[0] = stable_cdf_g(theta[0], (void*)ctx);
 
-	theta[SUBS_def] = M_PI_2 - THETA_TH;
-	g[SUBS_def] = stable_cdf_g(theta[SUBS_def], (void*)dist);
+	theta[SUBS_def] = M_PI_2 - cfg->THETA_TH;
+	g[SUBS_def] = stable_cdf_g(theta[SUBS_def], (void*)ctx);
 
 	method_[0] = STABLE_QAG2;
 	method_[1] = STABLE_QAG2;
 	//    method_[2] = STABLE_QAG1;
 
-	if (dist->alfa > 1.0 || (dist->alfa == 1 && dist->beta_ < 0)) { //Entonces max a la derecha
+	if (dist->alfa > 1.0 || (dist->alfa == 1 && ctx->beta_ < 0)) { //Entonces max a la derecha
 		for (k = SUBS_def - 1; k >= 0; k--) {
 			if (k > 0) {
-				theta[k] = zbrent(auxiliar, (void*)dist, theta[0], theta[k + 1],
+				theta[k] = zbrent(auxiliar, (void*)ctx, theta[0], theta[k + 1],
 								  -log(g[k + 1] * 1e-2), 1e-3 * (theta[k + 1] - theta[0]), &warnz[k]);
 			}
 
 
-			g[k] = stable_cdf_g(theta[k], (void*)dist);
+			g[k] = stable_cdf_g(theta[k], (void*)ctx);
 
-			stable_integration(dist, integrando,
+			stable_integration(ctx, integrando,
 							   theta[k], theta[k + 1],
-							   max(cdf * relTOL, absTOL) / SUBS_def, relTOL, IT_MAX,
+							   max(cdf * cfg->relTOL, cfg->absTOL) / SUBS_def, cfg->relTOL, cfg->IT_MAX,
 							   &cdf1, &err1, method_[SUBS_def - k - 1]);
 			cdf += cdf1;
 			*err += err1 * err1;
@@ -278,18 +266,18 @@ stable_integration_cdf(StableDist *dist, double(*integrando)(double, void*),
 		                     IT_MAX,dist->gslworkspace,&cdf,&err);*/
 	}
 
-	else if (dist->alfa < 1.0 || (dist->alfa == 1 && dist->beta_ > 0)) { //Entonces max a la izqda
+	else if (dist->alfa < 1.0 || (dist->alfa == 1 && ctx->beta_ > 0)) { //Entonces max a la izqda
 		for (k = 1; k <= SUBS_def; k++) {
 			if (k < SUBS_def) {
-				theta[k] = zbrent(auxiliar, (void*)dist, theta[k - 1], theta[SUBS_def],
+				theta[k] = zbrent(auxiliar, (void*)ctx, theta[k - 1], theta[SUBS_def],
 								  -log(g[k - 1] * 1e-2), 1e-3 * (theta[SUBS_def] - theta[k - 1]), &warnz[k]);
 			}
 
-			g[k] = stable_cdf_g(theta[k], (void*)dist);
+			g[k] = stable_cdf_g(theta[k], (void*)ctx);
 
-			stable_integration(dist, integrando,
+			stable_integration(ctx, integrando,
 							   theta[k - 1], theta[k],
-							   max(cdf * relTOL, absTOL) / SUBS_def, relTOL, IT_MAX,
+							   max(cdf * cfg->relTOL, cfg->absTOL) / SUBS_def, cfg->relTOL, cfg->IT_MAX,
 							   &cdf1, &err1, method_[k - 1]);
 			cdf += cdf1;
 			*err += err1 * err1;
@@ -313,7 +301,7 @@ stable_integration_cdf(StableDist *dist, double(*integrando)(double, void*),
 /******************************************************************************/
 
 double
-stable_cdf_point_GAUSS(StableDist *dist, const double x, double *err)
+stable_cdf_point_GAUSS(const StableDist *dist, const double x, double *err)
 {
 	double x_ = (x - dist->mu_0) / dist->sigma;
 	*err = 0.0;
@@ -322,7 +310,7 @@ stable_cdf_point_GAUSS(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_cdf_point_CAUCHY(StableDist *dist, const double x, double *err)
+stable_cdf_point_CAUCHY(const StableDist *dist, const double x, double *err)
 {
 	double x_ = (x - dist->mu_0) / dist->sigma;
 	*err = 0.0;
@@ -331,44 +319,55 @@ stable_cdf_point_CAUCHY(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_cdf_point_LEVY(StableDist *dist, const double x, double *err)
+stable_cdf_point_LEVY(const StableDist *dist, const double x, double *err)
 {
 	double xxi = (x - dist->mu_0) / dist->sigma - dist->xi;
 
-	if (xxi > 0 && dist->beta > 0)
-		return gsl_sf_erfc(sqrt(0.5 / xxi));
-	else if (xxi < 0 && dist->beta < 0)
-		return gsl_sf_erfc(sqrt(-0.5 / xxi));
-	else return 0.0;
+	*err = 0.0;
+
+	if (dist->beta > 0)
+		return xxi > 0 ? gsl_sf_erfc(sqrt(0.5 / xxi)) : 0.0;
+	else
+		return xxi < 0 ? gsl_sf_erf(sqrt(-0.5 / xxi)) : 1.0;
 }
 
 /******************************************************************************/
 /*   CDF en otros casos                                                       */
 /******************************************************************************/
 double
-stable_cdf_point_ALFA_1(StableDist *dist, const double x, double *err)
+stable_cdf_point_ALFA_1(const StableDist *dist, const double x, double *err)
 {
 	double cdf = 0;
 	double x_;
+	StableEvalCtx ctx;
 
 	double(*integrando)(double, void *) = &stable_cdf_g1;
 	double(*auxiliar)(double, void *) = &stable_cdf_g_aux1;
 
+	stable_eval_ctx_init(&ctx, dist);
+
 	x_ = (x - dist->mu_0) / dist->sigma;
 
 	*err = 0.0;
 
+	/* Far from xi the tail expansion replaces the integration, if precise.
+	   It gives the tail probability, 1 - cdf on the right tail. */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_TAILS) &&
+		stable_tail_series_point(&dist->tail[CDF][x_ < 0], fabs(x_),
+								 ctx.cfg.relTOL, &cdf, err))
+		return x_ < 0 ? cdf : 1.0 - cdf;
+
 	if (dist->beta < 0.0) {
 		x_ = -x_;
-		dist->beta_ = -dist->beta;
-	} else dist->beta_ = dist->beta;
+		ctx.beta_ = -dist->beta;
+	} else ctx.beta_ = dist->beta;
 
-	//dist->xxipow = exp(-PI*x_*0.5/dist->beta_);
-	dist->xxipow = (-M_PI * x_ * 0.5 / dist->beta_);
+	//ctx.xxipow = exp(-PI*x_*0.5/ctx.beta_);
+	ctx.xxipow = (-M_PI * x_ * 0.5 / ctx.beta_);
 	integrando = &stable_cdf_g1;
 	auxiliar = &stable_cdf_g_aux1;
 
-	cdf = stable_integration_cdf(dist, integrando, auxiliar, err);
+	cdf = stable_integration_cdf(&ctx, integrando, auxiliar, err);
 
 	if (dist->beta > 0)
 		cdf = dist->c3 * cdf;
@@ -382,38 +381,56 @@ stable_cdf_point_ALFA_1(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_cdf_point_STABLE(StableDist *dist, const double x, double *err)
+stable_cdf_point_STABLE(const StableDist *dist, const double x, double *err)
 {
 	double cdf = 0;
 	double x_, xxi;
+	StableEvalCtx ctx;
 
 	double(*integrando)(double, void *) = &stable_cdf_g2;
 	double(*auxiliar)(double, void *) = &stable_cdf_g_aux2;
+	stable_eval_ctx_init(&ctx, dist);
+
 	x_ = (x - dist->mu_0) / dist->sigma;
 	xxi = x_ - dist->xi;
 	*err = 0.0;
 
+	/* Near xi the power series replaces the integration, if precise */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_CENTER) &&
+		stable_center_series_point(&dist->center[CDF], xxi, ctx.cfg.relTOL,
+								   &cdf, err))
+		return cdf;
+
 	//xxi_th = pow(10,XXI_TH/fabs(dist->alfainvalfa1));//REVISAR CON NOLAN...
 	/*Si justo evaluo en o cerca de xi*/
-	if (fabs(xxi) < XXI_TH) {
+	if (fabs(xxi) < ctx.cfg.XXI_TH) {
 		// printf("_%lf_\n",x);
 		cdf = M_1_PI * (M_PI_2 - dist->theta0);
 		return cdf;
-	} else if (xxi < 0) { /*F(x<xi,alfa,beta) = 1-F(-x,alfa,-beta)*/
-		dist->theta0_ = -dist->theta0; /*theta0(alfa,-beta)=-theta0(alfa,beta)*/
-		dist->beta_ = -dist->beta;
+	}
+
+	/* Far from xi the tail expansion replaces the integration, if precise.
+	   It gives the tail probability, 1 - cdf on the right tail. */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_TAILS) &&
+		stable_tail_series_point(&dist->tail[CDF][xxi < 0], fabs(xxi),
+								 ctx.cfg.relTOL, &cdf, err))
+		return xxi < 0 ? cdf : 1.0 - cdf;
+
+	if (xxi < 0) { /*F(x<xi,alfa,beta) = 1-F(-x,alfa,-beta)*/
+		ctx.theta0_ = -dist->theta0; /*theta0(alfa,-beta)=-theta0(alfa,beta)*/
+		ctx.beta_ = -dist->beta;
 	} else {
-		dist->theta0_ = dist->theta0;
-		dist->beta_ = dist->beta;
+		ctx.theta0_ = dist->theta0;
+		ctx.beta_ = dist->beta;
 
-		if (fabs(dist->theta0_ + M_PI_2) < THETA_TH) return 1.0;
+		if (fabs(ctx.theta0_ + M_PI_2) < ctx.cfg.THETA_TH) return 1.0;
 	}
 
-	//dist->xxipow=pow(fabs(xxi),dist->alfainvalfa1);
-	dist->xxipow = dist->alfainvalfa1 * log(fabs(xxi));
+	//ctx.xxipow=pow(fabs(xxi),dist->alfainvalfa1);
+	ctx.xxipow = dist->alfainvalfa1 * log(fabs(xxi));
 
 	//Solo si alfa1 o zona estable.
-	cdf = stable_integration_cdf(dist, integrando, auxiliar, err);
+	cdf = stable_integration_cdf(&ctx, integrando, auxiliar, err);
 
 	if (xxi > 0)
 		cdf = dist->c1 + dist->c3 * cdf;
@@ -430,7 +447,7 @@ stable_cdf_point_STABLE(StableDist *dist, const double x, double *err)
 /******************************************************************************/
 
 double
-stable_cdf_point(StableDist *dist, const double x, double *err)
+stable_cdf_point(const StableDist *dist, const double x, double *err)
 {
 	double temp;
 
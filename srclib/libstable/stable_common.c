@@ -36,6 +36,7 @@ FILE * FLOG = NULL;            // Log file (optional)
 FILE * FINTEG = NULL;          // Integrand evaluations output file (debug purposes)
 
 unsigned short THREADS = 0;    // threads of execution (0 => total available)
+unsigned int CHUNK_SIZE = 0;   // points taken at once by each thread (0 => automatic)
 unsigned short IT_MAX = 1000;  // Maximum # of iterations in quadrature methods
 unsigned short SUBS = 3;       // # of integration subintervals
 unsigned short METHOD = STABLE_QNG;  // Integration method on main subinterval
@@ -54,8 +55,8 @@ double EXP_MAX = -200;       // Exponent maximum value
 double XXI_TH = 0.00001;     // Zeta threshold
 double THETA_TH = 10 * EPS;  // Theta threshold
 
-double AUX1 = -13.81551056; //log(1e-6) // Auxiliary values
-double AUX2 =  2.91099795; //log(18)
+unsigned short EVAL_MODE = STABLE_EVAL_TAILS | STABLE_EVAL_CENTER; // Alternatives to the numerical integration
+
 
 #ifdef DEBUG
 unsigned int integ_eval = 0; // # of integrand evaluations
@@ -29,11 +29,14 @@
 #include <gsl/gsl_errno.h>
 
 #include "stable_api.h"
+#include "stable_pool.h"
+#include "stable_table.h"
 //#include "stable_common.h"
 
 #include <pthread.h>
 #include <math.h>
 #include <unistd.h>
+#include <limits.h>
 
 /*----------------------------------------------------------------------------*/
 /*                             Public part                                    */
@@ -45,12 +48,28 @@ unsigned int stable_get_THREADS()
 }
 void stable_set_THREADS(unsigned int value)
 {
+	unsigned short previous = THREADS;
+
 	if (value <= 0) THREADS = sysconf(_SC_NPROCESSORS_ONLN);
 	else THREADS = value;
 
+	// The worker pool is rebuilt with the new size on its next use.
+	if (THREADS != previous)
+		stable_pool_resize();
+
 	//printf("\nCPUs = %u\n",THREADS);
 }
 
+unsigned int stable_get_CHUNK_SIZE()
+{
+	return CHUNK_SIZE;
+}
+void stable_set_CHUNK_SIZE(unsigned int value)
+{
+	// Chunks are taken with int indexes in stable_pool_take.
+	CHUNK_SIZE = min(value, (unsigned int) INT_MAX);
+}
+
 int stable_get_METHOD()
 {
 	return METHOD;
@@ -142,7 +161,8 @@ void stable_set_BETA_TH(double value)
 	BETA_TH = value;
 }
 
-/* When abs(x-xxi)<XXI_TH x is set to XXI */
+/* When abs(x-xxi)<XXI_TH x is set to XXI, unless the power series around xi
+   is used there (STABLE_EVAL_CENTER) */
 double stable_get_XXI_TH()
 {
 	return XXI_TH;
@@ -162,6 +182,17 @@ void stable_set_THETA_TH(double value)
 	THETA_TH = value;
 }
 
+/* Flags of the methods used instead of the numerical integration where they
+   are precise enough (STABLE_EVAL_INTEG disables all of them) */
+int stable_get_EVAL_MODE()
+{
+	return EVAL_MODE;
+}
+void stable_set_EVAL_MODE(int value)
+{
+	EVAL_MODE = value;
+}
+
 /* Debug purposes*/
 FILE * stable_get_FINTEG()
 {
@@ -230,6 +261,8 @@ int stable_setparams(StableDist *dist,
 						   + log(fabs(dist->alfa - 1.0));
 			dist->stable_pdf_point = &stable_pdf_point_STABLE;
 			dist->stable_cdf_point = &stable_cdf_point_STABLE;
+			dist->stable_rnd_transform = dist->beta == 0 ?
+										 &stable_rnd_transform_SYMMETRIC : &stable_rnd_transform_STABLE;
 
 			if (alfa < 1.0) {
 				dist->c1 = 0.5 - dist->theta0 * M_1_PI;
@@ -244,14 +277,6 @@ int stable_setparams(StableDist *dist,
 			//XXI_TH = pow(10,EXP_MAX/fabs(dist->alfainvalfa1));//REVISAR CON NOLAN...
 			//XXI_TH = max(XXI_TH,10*EPS);
 
-			if (alfa > 1) {
-				AUX1 = log(log(8.5358 / (relTOL)) / 0.9599); /*3.76;*/
-				AUX2 = log(relTOL); /*-40;*/
-			} else {
-				AUX1 = log(relTOL); /*-40;*/
-				AUX2 = log(log(8.5358 / (relTOL)) / 0.9599); /*3.76;*/
-			}
-
 			break;
 
 		case ALFA_1_B1:
@@ -271,15 +296,9 @@ int stable_setparams(StableDist *dist,
 			dist->Vbeta1 = 2.0 * M_1_PI / M_E;
 			dist->stable_pdf_point = &stable_pdf_point_ALFA_1;
 			dist->stable_cdf_point = &stable_cdf_point_ALFA_1;
+			dist->stable_rnd_transform = &stable_rnd_transform_ALFA_1;
 
 			//XXI_TH = 10*EPS;
-			if (beta < 0) {
-				AUX1 = log(log(8.5358 / (relTOL)) / 0.9599); /*4;*/
-				AUX2 = log(relTOL); /*-25;*/
-			} else {
-				AUX1 = log(relTOL); /*-25;*/
-				AUX2 = log(log(8.5358 / (relTOL)) / 0.9599); /*4;*/
-			}
 
 			break;
 
@@ -298,6 +317,7 @@ int stable_setparams(StableDist *dist,
 			dist->Vbeta1 = 2.0 * M_1_PI / M_E;
 			dist->stable_pdf_point = &stable_pdf_point_CAUCHY;
 			dist->stable_cdf_point = &stable_cdf_point_CAUCHY;
+			dist->stable_rnd_transform = &stable_rnd_transform_CAUCHY;
 			break;
 
 		case GAUSS:
@@ -315,6 +335,7 @@ int stable_setparams(StableDist *dist,
 			dist->Vbeta1 = 0.25;
 			dist->stable_pdf_point = &stable_pdf_point_GAUSS;
 			dist->stable_cdf_point = &stable_cdf_point_GAUSS;
+			dist->stable_rnd_transform = &stable_rnd_transform_GAUSS;
 			break;
 
 		case LEVY:
@@ -332,6 +353,7 @@ int stable_setparams(StableDist *dist,
 						   + log(fabs(dist->alfa - 1.0));
 			dist->stable_pdf_point = &stable_pdf_point_LEVY;
 			dist->stable_cdf_point = &stable_cdf_point_LEVY;
+			dist->stable_rnd_transform = &stable_rnd_transform_LEVY;
 			break;
 	}
 
@@ -349,11 +371,20 @@ int stable_setparams(StableDist *dist,
 		else dist->mu_0 = mu - dist->xi * dist->sigma;
 	}
 
-	dist->theta0_ = dist->theta0;
-	dist->beta_ = dist->beta;
-	dist->xxipow = 0.0;
 	dist->ZONE = zona;
 
+	if (zona == STABLE) {
+		stable_center_series_init(&dist->center[CDF], dist, CDF);
+		stable_center_series_init(&dist->center[PDF], dist, PDF);
+	}
+
+	if (zona == STABLE || zona == ALFA_1) {
+		stable_tail_series_init(&dist->tail[CDF][0], dist, CDF, 0);
+		stable_tail_series_init(&dist->tail[CDF][1], dist, CDF, 1);
+		stable_tail_series_init(&dist->tail[PDF][0], dist, PDF, 0);
+		stable_tail_series_init(&dist->tail[PDF][1], dist, PDF, 1);
+	}
+
 	return zona;
 }
 
@@ -416,10 +447,14 @@ StableDist * stable_create(double alfa, double beta, double sigma, double mu,
 	}
 
 	gsl_rng_env_setup(); //leemos las variables de entorno
-	dist->gslworkspace = gsl_integration_workspace_alloc(IT_MAX);
 	dist->gslrand = gsl_rng_alloc(gsl_rng_default);
+	dist->rnd_key = gsl_rng_default_seed;
+	dist->rnd_stream = 0;
+	dist->rnd_index = 0;
 	dist->gpu_enabled = 0;
 	dist->gpu_queues = 1;
+	dist->has_config = 0;
+	dist->table = NULL;
 
 #ifdef DEFAULT_ACCELERATOR
 	dist->gpu_platform = DEFAULT_ACCELERATOR;
@@ -462,9 +497,66 @@ StableDist * stable_copy(StableDist *src_dist)
 
 	dist = stable_create(src_dist->alfa, src_dist->beta,
 						 src_dist->sigma, src_dist->mu_0, 0);
+
+	if (dist == NULL)
+		return NULL;
+
+	if (src_dist->has_config)
+		stable_set_config(dist, &src_dist->config);
+
+	/* Same position of the generators, so the copy continues the stream */
+	gsl_rng_memcpy(dist->gslrand, src_dist->gslrand);
+	dist->rnd_key = src_dist->rnd_key;
+	dist->rnd_stream = src_dist->rnd_stream;
+	dist->rnd_index = src_dist->rnd_index;
+
+	/* And the same variates, which come from the quantile table once built */
+	if (stable_table_rnd_copy(dist, src_dist) < 0) {
+		stable_free(dist);
+		return NULL;
+	}
+
 	return dist;
 }
 
+void stable_config_init(struct stable_config *config)
+{
+	config->THREADS = THREADS;
+	config->IT_MAX = IT_MAX;
+	config->METHOD = METHOD;
+	config->METHOD2 = METHOD2;
+	config->METHOD3 = METHOD3;
+	config->INV_MAXITER = INV_MAXITER;
+	config->relTOL = relTOL;
+	config->absTOL = absTOL;
+	config->XXI_TH = XXI_TH;
+	config->THETA_TH = THETA_TH;
+	config->EVAL_MODE = EVAL_MODE;
+	config->FIT_EPSABS = STABLE_FIT_EPSABS;
+	config->FIT_MAXITER = STABLE_FIT_MAXITER;
+	config->FIT_BINS = STABLE_FIT_BINS;
+	config->FIT_STARTS = STABLE_FIT_STARTS;
+}
+
+void stable_set_config(StableDist *dist, const struct stable_config *config)
+{
+	if (config == NULL) {
+		dist->has_config = 0;
+		return;
+	}
+
+	dist->config = *config;
+	dist->has_config = 1;
+}
+
+void stable_get_config(const StableDist *dist, struct stable_config *config)
+{
+	if (dist->has_config)
+		*config = dist->config;
+	else
+		stable_config_init(config);
+}
+
 void stable_free(StableDist *dist)
 {
 	if (dist == NULL)
@@ -473,7 +565,7 @@ void stable_free(StableDist *dist)
 	if (dist->gpu_enabled)
 		stable_deactivate_gpu(dist);
 
-	gsl_integration_workspace_free(dist->gslworkspace);
+	stable_table_free(dist);
 	gsl_rng_free(dist->gslrand);
 	free(dist);
 }
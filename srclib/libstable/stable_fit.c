@@ -28,6 +28,7 @@
  */
 #include "stable_api.h"
 #include "mcculloch.h"
+#include "stable_pool.h"
 
 #include <gsl/gsl_complex.h>
 #include <gsl/gsl_vector.h>
@@ -37,11 +38,6 @@
 #include <gsl/gsl_multimin.h>
 #include <gsl/gsl_fft_real.h>
 
-#define ESTM_2D_EPSABS 0.008
-#define ESTM_2D_MAX_ITER 300
-#define ESTM_4D_EPSABS 0.008
-#define ESTM_4D_MAX_ITER 300
-
 
 void get_original(const gsl_vector *s, double *a, double *b, double *c, double *m);
 void set_expanded(gsl_vector *s, const double a, const double b, const double c, const double m);
@@ -65,7 +61,7 @@ double stable_loglikelihood(StableDist *dist, double *data, const unsigned int l
 
 	pdf = malloc(sizeof(double) * length);
 
-	stable_pdf(dist, data, length, pdf, NULL);
+	stable_v_pdf(dist, data, length, pdf, NULL);
 
 	for (i = 0; i < length; i++) {
 		if (pdf[i] > 0.0) l += log(pdf[i]);
@@ -75,15 +71,111 @@ double stable_loglikelihood(StableDist *dist, double *data, const unsigned int l
 	return l;
 }
 
+/*
+ * Binned likelihood. With FIT_BINS > 0 the fits group the sorted data in
+ * bins of equal counts, so bins are narrow where the data are dense and the
+ * last ones reach out to the tails, and maximize the likelihood of the
+ * counts, sum n_b log(P_b). The probability P_b of each bin is the
+ * difference of the CDF at its edges, so the estimate keeps no bias from the
+ * grouping, but the position of the samples inside a bin is lost: the
+ * variance grows as the bins get wider, mostly that of alfa, whose
+ * information lies in the tails. A likelihood evaluation costs FIT_BINS - 1
+ * CDFs instead of one PDF per sample.
+ */
+
+#define STABLE_FIT_BIN_MIN 10  // Minimum mean # of samples per bin
+
+/* Inner edges halfway between the samples that split the sorted data in
+   bins of equal counts. Ties are merged in a single bin. Returns -1 if the
+   bins can not be allocated, or the data could not be sorted */
+static short _fit_bins_init(stable_like_params *par, const double *sorted,
+							const unsigned int length, unsigned int bins)
+{
+	unsigned int b, i, j, n;
+	double edge;
+
+	par->bins = 0;
+	par->edges = NULL;
+	par->counts = NULL;
+
+	if (bins < 2 || length < STABLE_FIT_BIN_MIN * bins)
+		return 0;
+
+	if (sorted == NULL) {
+		perror("Error en la reserva de memoria");
+		return -1;
+	}
+
+	par->edges = malloc((bins - 1) * sizeof(double));
+	par->counts = calloc(bins, sizeof(double));
+
+	if (par->edges == NULL || par->counts == NULL) {
+		perror("Error en la reserva de memoria");
+		free(par->edges);
+		free(par->counts);
+		par->edges = par->counts = NULL;
+		return -1;
+	}
+
+	for (b = 1, n = 0; b < bins; b++) {
+		j = (unsigned int)((double) b * length / bins);
+		edge = 0.5 * (sorted[j - 1] + sorted[j]);
+
+		if (n == 0 || edge > par->edges[n - 1])
+			par->edges[n++] = edge;
+	}
+
+	for (i = 0, b = 0; i < length; i++) {
+		while (b < n && sorted[i] > par->edges[b])
+			b++;
+
+		par->counts[b]++;
+	}
+
+	par->bins = n + 1;
+
+	return 0;
+}
+
+/* Where the CDF does not grow from one edge to the next (numerical error of
+   the CDF) the bin is merged with the following ones, as skipping its counts
+   would favour the parameters where the CDF fails */
+static double _loglike_binned(stable_like_params *params)
+{
+	double l = 0.0, prev = 0.0, cdf, n = 0.0, *F = params->pdf;
+	unsigned int b;
+
+	if (params->dist->gpu_enabled)
+		stable_cdf_gpu(params->dist, params->edges, params->bins - 1, F, NULL);
+	else
+		stable_cdf(params->dist, params->edges, params->bins - 1, F, NULL);
+
+	for (b = 0; b < params->bins; b++) {
+		cdf = b < params->bins - 1 ? F[b] : 1.0;
+		n += params->counts[b];
+
+		if (cdf > prev) {
+			l += n * log(cdf - prev);
+			prev = cdf;
+			n = 0.0;
+		}
+	}
+
+	return n > 0.0 ? -INFINITY : l;
+}
+
 double stable_loglike_p(stable_like_params *params)
 {
 	double l = 0.0;
 	int i;
 
+	if (params->bins > 0)
+		return _loglike_binned(params);
+
 	if (params->dist->gpu_enabled)
 		stable_pdf_gpu(params->dist, params->data, params->length, params->pdf, NULL);
 	else
-		stable_pdf(params->dist, params->data, params->length, params->pdf, NULL);
+		stable_v_pdf(params->dist, params->data, params->length, params->pdf, NULL);
 
 	for (i = 0; i < params->length; i++)
 		if (params->pdf[i] > 0.0)
@@ -126,6 +218,22 @@ int compare(const void * a, const void * b)
 	return ((*(double *)b < * (double *)a) - (*(double *)a < * (double *)b));
 }
 
+/* Sorted copy of the data for the likelihood of a fit, or NULL. Standardized
+   points keep the order of the data for any sigma and mu, so the batch PDF
+   finds them already sorted in every evaluation */
+static double *_fit_sorted_copy(const double *data, const unsigned int length)
+{
+	double *sorted = malloc(length * sizeof(double));
+
+	if (sorted == NULL)
+		return NULL;
+
+	memcpy(sorted, data, length * sizeof(double));
+	qsort(sorted, length, sizeof(double), compare);
+
+	return sorted;
+}
+
 inline void get_original(const gsl_vector *s, double *a, double *b, double *c, double *m)
 {
 	*a = M_2_PI * atan(gsl_vector_get(s, 0)) + 1.0;
@@ -210,15 +318,27 @@ int stable_fit_iter(StableDist *dist, const double * data, const unsigned int le
 
 	double a = 1, b = 0.0, c = 1, m = 0.0;
 	stable_like_params par;
+	struct stable_config cfg;
+	double *sorted;
+
+	stable_get_config(dist, &cfg);
 
 	par.dist = dist;
-	par.data = (double *)data;
+	sorted = _fit_sorted_copy(data, length);
+	par.data = sorted != NULL ? sorted : (double *)data;
 	par.length = length;
 	par.nu_c = nu_c;
 	par.nu_z = nu_z;
 	par.pdf = (double*) calloc(length, sizeof(double));
 	par.err = (double*) calloc(length, sizeof(double));
 
+	if (_fit_bins_init(&par, sorted, length, cfg.FIT_BINS) < 0) {
+		free(par.err);
+		free(par.pdf);
+		free(sorted);
+		return -1;
+	}
+
 	/* Inicio: Debe haberse inicializado dist con alfa y beta de McCulloch */
 	theta = gsl_vector_alloc(2);
 	gsl_vector_set(theta, 0, dist->alfa);
@@ -259,7 +379,7 @@ int stable_fit_iter(StableDist *dist, const double * data, const unsigned int le
 		//      }
 
 		size = gsl_multimin_fminimizer_size(s);
-		status = gsl_multimin_test_size(size, ESTM_2D_EPSABS);
+		status = gsl_multimin_test_size(size, cfg.FIT_EPSABS);
 		/*
 					if (status == GSL_SUCCESS)
 						{
@@ -275,7 +395,7 @@ int stable_fit_iter(StableDist *dist, const double * data, const unsigned int le
 									s->fval, size);
 						//}
 		*/
-	} while (status == GSL_CONTINUE && iter < ESTM_2D_MAX_ITER);
+	} while (status == GSL_CONTINUE && iter < cfg.FIT_MAXITER);
 
 	//  if (status!=GSL_SUCCESS)
 	//    {
@@ -306,8 +426,11 @@ int stable_fit_iter(StableDist *dist, const double * data, const unsigned int le
 
 	gsl_vector_free(ss);
 	gsl_multimin_fminimizer_free(s);
+	free(par.edges);
+	free(par.counts);
 	free(par.err);
 	free(par.pdf);
+	free(sorted);
 
 	return status;
 }
@@ -323,46 +446,35 @@ int stable_fit(StableDist *dist, const double *data, const unsigned int length)
 	return status;
 }
 
-int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned int length)
+/* Simplex on the expanded parameters of set_expanded from theta, with initial
+   steps of size step. The estimation is left in theta and its minus
+   log-likelihood in f */
+static int _fit_simplex_whole(stable_like_params *par, gsl_vector *theta, const double step,
+							  const struct stable_config *cfg, double *f)
 {
 	const gsl_multimin_fminimizer_type *T;
 	gsl_multimin_fminimizer *s;
 
 	gsl_multimin_function likelihood_func;
 
-	gsl_vector *theta, *ss;
+	gsl_vector *ss;
 
 	unsigned int iter = 0;
 	int status = 0;
 	double size = 0;
 
-	double a = 1, b = 0.0, c = 1, m = 0.0;
-	stable_like_params par;
-
-	par.dist = dist;
-	par.data = (double *)data;
-	par.length = length;
-	par.nu_c = 0;
-	par.nu_z = 0;
-	par.pdf = (double*) calloc(length, sizeof(double));
-	par.err = (double*) calloc(length, sizeof(double));
-
-	/* Inicio: Debe haberse inicializado dist con McCulloch */
-	theta = gsl_vector_alloc(4);
-	set_expanded(theta, dist->alfa, dist->beta, dist->sigma, dist->mu_1);
-
 #ifdef DEBUG
 	printf("%lf, %lf, %lf, %lf\n", gsl_vector_get(theta, 0), gsl_vector_get(theta, 1), gsl_vector_get(theta, 2), gsl_vector_get(theta, 3));
 #endif
 
 	/* Saltos iniciales */
 	ss = gsl_vector_alloc(4);
-	gsl_vector_set_all(ss, 0.01);
+	gsl_vector_set_all(ss, step);
 
 	/* Funcion a minimizar */
 	likelihood_func.n = 4; // Dimension 4
 	likelihood_func.f = &stable_minusloglikelihood_whole;
-	likelihood_func.params = (void *)(&par);   // Parametros de la funcion
+	likelihood_func.params = (void *)par;   // Parametros de la funcion
 
 	/* Creacion del minimizer */
 	T = gsl_multimin_fminimizer_nmsimplex2rand;
@@ -372,11 +484,6 @@ int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned
 	/* Poner funcion, estimacion inicial, saltos iniciales */
 	gsl_multimin_fminimizer_set(s, &likelihood_func, theta, ss);
 
-
-#ifdef DEBUG
-	printf("5\n");
-#endif
-
 	/* Iterar */
 	do {
 		iter++;
@@ -388,15 +495,13 @@ int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned
 		}
 
 		size   = gsl_multimin_fminimizer_size(s);
-		status = gsl_multimin_test_size(size, ESTM_4D_EPSABS);
+		status = gsl_multimin_test_size(size, cfg->FIT_EPSABS);
 
 		//      printf(" %03d\t size = %f a_ = %f  b_ = %f  c_ = %f  m_ = %f\n",iter,size,gsl_vector_get (s->x, 0),gsl_vector_get (s->x, 1),
 		//                                                           gsl_vector_get (s->x, 2),gsl_vector_get (s->x, 3));
 		//      fflush(stdout);
 
-	} while (status == GSL_CONTINUE && iter < ESTM_4D_MAX_ITER);
-
-
+	} while (status == GSL_CONTINUE && iter < cfg->FIT_MAXITER);
 
 	if (status != GSL_SUCCESS) {
 		printf("Minimizer warning: %s\n", gsl_strerror(status));
@@ -404,9 +509,198 @@ int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned
 	}
 
 	/* Se recupera la estimacion */
+	gsl_vector_memcpy(theta, gsl_multimin_fminimizer_x(s));
+	*f = gsl_multimin_fminimizer_minimum(s);
+
+	gsl_vector_free(ss);
+	gsl_multimin_fminimizer_free(s);
+
+	return status;
+}
+
+/* Starts of the simplex, taken by the workers of the pool. Each worker fits
+   on its own copy of the distribution, made before the job and kept for all
+   the starts it takes, and with its own buffers */
+typedef struct {
+	StableDist **dists;             // One per worker
+	const stable_like_params *par;  // Data and bins, shared by all the starts
+	const struct stable_config *cfg;
+	double step;
+	int starts;
+	double *theta;  // 4 * starts: initial points, replaced by the estimations
+	double *f;      // Minus log-likelihood of each estimation
+	int *status;
+	int next;       // First start not yet taken by any thread
+} StableArgsFitStarts;
+
+static void thread_init_fit_starts(struct stable_worker *worker, void *ptr_args)
+{
+	StableArgsFitStarts *args = (StableArgsFitStarts *)ptr_args;
+	stable_like_params par = *args->par;
+	gsl_vector *theta;
+	int k, end, j;
+
+	par.dist = args->dists[worker->index];
+	par.pdf = (double*) calloc(par.length, sizeof(double));
+	par.err = (double*) calloc(par.length, sizeof(double));
+	theta = gsl_vector_alloc(4);
+
+	while (stable_pool_take(worker, &args->next, args->starts, &k, &end)) {
+		for (; k < end; k++) {
+			args->f[k] = GSL_NAN;
+			args->status[k] = -1;
+
+			if (par.pdf == NULL || par.err == NULL || theta == NULL)
+				continue;
+
+			for (j = 0; j < 4; j++)
+				gsl_vector_set(theta, j, args->theta[4 * k + j]);
+
+			args->status[k] = _fit_simplex_whole(&par, theta, args->step, args->cfg, args->f + k);
+
+			for (j = 0; j < 4; j++)
+				args->theta[4 * k + j] = gsl_vector_get(theta, j);
+		}
+	}
+
+	if (theta != NULL)
+		gsl_vector_free(theta);
+
+	free(par.err);
+	free(par.pdf);
+}
+
+/* Spread of the starts around the initial point, on the expanded parameters
+   (mu relative to sigma), and seed of their perturbations */
+#define STABLE_FIT_START_SPREAD 0.25
+#define STABLE_FIT_START_SEED 1
+
+/* FIT_STARTS simplices in parallel, from theta and from random perturbations
+   of it. The one with the largest likelihood is left in theta */
+static int _fit_starts_whole(StableDist *dist, const stable_like_params *par, gsl_vector *theta,
+							 const double step, const struct stable_config *cfg)
+{
+	StableArgsFitStarts args;
+	unsigned int workers, k, j, best = 0;
+	double spread;
+	gsl_rng *rng;
+	int status = -1;
+
+	workers = cfg->THREADS == 0 || cfg->THREADS > THREADS ? THREADS : cfg->THREADS;
+	workers = max(1, min(workers, cfg->FIT_STARTS));
+
+	args.par = par;
+	args.cfg = cfg;
+	args.step = step;
+	args.starts = cfg->FIT_STARTS;
+	args.next = 0;
+	args.dists = (StableDist **) calloc(workers, sizeof(StableDist *));
+	args.theta = (double *) malloc(4 * args.starts * sizeof(double));
+	args.f = (double *) malloc(args.starts * sizeof(double));
+	args.status = (int *) malloc(args.starts * sizeof(int));
+	rng = gsl_rng_alloc(gsl_rng_default);
+
+	if (args.dists == NULL || args.theta == NULL || args.f == NULL ||
+		args.status == NULL || rng == NULL) {
+		perror("Error en la reserva de memoria");
+		goto end;
+	}
+
+	for (k = 0; k < workers; k++) {
+		if ((args.dists[k] = stable_copy(dist)) == NULL)
+			goto end;
+	}
+
+	/* El primer inicio es el punto dado */
+	gsl_rng_set(rng, STABLE_FIT_START_SEED);
+
+	for (k = 0; k < args.starts; k++) {
+		for (j = 0; j < 4; j++) {
+			spread = k == 0 ? 0.0 : STABLE_FIT_START_SPREAD;
+
+			if (j == 3)
+				spread *= exp(gsl_vector_get(theta, 2));
+
+			args.theta[4 * k + j] = gsl_vector_get(theta, j) + gsl_ran_gaussian(rng, spread);
+		}
+	}
+
+	stable_pool_run(workers, thread_init_fit_starts, &args);
+
+	for (k = 0; k < args.starts; k++) {
+#ifdef DEBUG
+		printf("Inicio %u: -log L = %lf\n", k, args.f[k]);
+#endif
+
+		if (args.f[k] < args.f[best] || (isnan(args.f[best]) && !isnan(args.f[k])))
+			best = k;
+	}
+
+	for (j = 0; j < 4; j++)
+		gsl_vector_set(theta, j, args.theta[4 * best + j]);
+
+	status = args.status[best];
+
+end:
+	if (args.dists != NULL)
+		for (k = 0; k < workers; k++)
+			if (args.dists[k] != NULL)
+				stable_free(args.dists[k]);
+
+	if (rng != NULL)
+		gsl_rng_free(rng);
+
+	free(args.dists);
+	free(args.theta);
+	free(args.f);
+	free(args.status);
+
+	return status;
+}
+
+/* Simplex of stable_fit_iter_whole from the parameters of dist, with
+   initial steps of size step */
+static int _fit_iter_whole(StableDist *dist, const double * data, const unsigned int length,
+						   const double step)
+{
+	gsl_vector *theta;
+
+	int status = 0;
+	double f = 0;
+
+	double a = 1, b = 0.0, c = 1, m = 0.0;
+	stable_like_params par;
+	struct stable_config cfg;
+	double *sorted;
+
+	stable_get_config(dist, &cfg);
+
+	par.dist = dist;
+	sorted = _fit_sorted_copy(data, length);
+	par.data = sorted != NULL ? sorted : (double *)data;
+	par.length = length;
+	par.nu_c = 0;
+	par.nu_z = 0;
+	par.pdf = (double*) calloc(length, sizeof(double));
+	par.err = (double*) calloc(length, sizeof(double));
+
+	if (_fit_bins_init(&par, sorted, length, cfg.FIT_BINS) < 0) {
+		free(par.err);
+		free(par.pdf);
+		free(sorted);
+		return -1;
+	}
+
+	/* Inicio: Debe haberse inicializado dist con McCulloch */
+	theta = gsl_vector_alloc(4);
+	set_expanded(theta, dist->alfa, dist->beta, dist->sigma, dist->mu_0);
+
+	/* Varios inicios en paralelo, o uno solo en este hilo */
+	if (cfg.FIT_STARTS > 1)
+		status = _fit_starts_whole(dist, &par, theta, step, &cfg);
+	else
+		status = _fit_simplex_whole(&par, theta, step, &cfg, &f);
 
-	gsl_vector_free(theta);
-	theta = gsl_multimin_fminimizer_x(s);
 	get_original(theta, &a, &b, &c, &m);
 
 	// Se almacena el punto estimado en la distribucion, comprobando que es valido
@@ -415,14 +709,21 @@ int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned
 		fflush(stdout);
 	}
 
-	gsl_vector_free(ss);
-	gsl_multimin_fminimizer_free(s);
+	gsl_vector_free(theta);
+	free(par.edges);
+	free(par.counts);
 	free(par.err);
 	free(par.pdf);
+	free(sorted);
 
 	return status;
 }
 
+int stable_fit_iter_whole(StableDist *dist, const double * data, const unsigned int length)
+{
+	return _fit_iter_whole(dist, data, length, 0.01);
+}
+
 int stable_fit_whole(StableDist *dist, const double *data, const unsigned int length)
 {
 	//  double nu_c=0.0,nu_z=0.0;
@@ -435,7 +736,250 @@ int stable_fit_whole(StableDist *dist, const double *data, const unsigned int le
 	return status;
 }
 
+/* Minus log-likelihood on the expanded parameters of set_expanded, and its
+   gradient from the derivatives of the PDF, both from one pass of
+   stable_pdf_grad. par->err holds the 4 * length derivatives. Where only the
+   likelihood is needed, stable_minusloglikelihood_whole is cheaper */
+static void _fit_grad_fdf(const gsl_vector *theta, void *p, double *f, gsl_vector *df)
+{
+	stable_like_params *par = (stable_like_params *) p;
+	double alfa = 1, beta = 0, sigma = 1.0, mu = 0.0;
+	double l = 0.0, dl[4] = {0, 0, 0, 0}, ds[4];
+	unsigned int i, k;
+
+	get_original(theta, &alfa, &beta, &sigma, &mu);
+
+	if (stable_setparams(par->dist, alfa, beta, sigma, mu, 0) < 0) {
+		if (f != NULL)
+			*f = GSL_NAN;
+
+		if (df != NULL)
+			gsl_vector_set_all(df, GSL_NAN);
+
+		return;
+	}
+
+	stable_pdf_grad(par->dist, par->data, par->length, par->pdf, par->err);
+
+	for (i = 0; i < par->length; i++) {
+		if (!(par->pdf[i] > 0.0))
+			continue;
+
+		l += log(par->pdf[i]);
+
+		for (k = 0; k < 4; k++)
+			dl[k] += par->err[4 * i + k] / par->pdf[i];
+	}
+
+	/* Derivadas de los parametros originales respecto de los expandidos */
+	ds[0] = M_2_PI / (1.0 + gsl_vector_get(theta, 0) * gsl_vector_get(theta, 0));
+	ds[1] = M_2_PI / (1.0 + gsl_vector_get(theta, 1) * gsl_vector_get(theta, 1));
+	ds[2] = sigma;
+	ds[3] = 1.0;
+
+	if (f != NULL)
+		*f = isfinite(l) ? -l : GSL_NAN;
+
+	if (df != NULL)
+		for (k = 0; k < 4; k++)
+			gsl_vector_set(df, k, -dl[k] * ds[k]);
+}
+
+static void _fit_grad_df(const gsl_vector *theta, void *p, gsl_vector *df)
+{
+	_fit_grad_fdf(theta, p, NULL, df);
+}
+
+int stable_fit_mle_grad(StableDist *dist, const double *data, const unsigned int length)
+{
+	const gsl_multimin_fdfminimizer_type *T;
+	gsl_multimin_fdfminimizer *s;
+
+	gsl_multimin_function_fdf likelihood_func;
+
+	gsl_vector *theta;
+
+	unsigned int iter = 0;
+	int status = 0;
+
+	double a = 1, b = 0.0, c = 1, m = 0.0;
+	stable_like_params par;
+	struct stable_config cfg;
+
+	/* Inicio: McCulloch */
+	if (stable_fit_init(dist, data, length, NULL, NULL) < 0)
+		return -1;
+
+	stable_get_config(dist, &cfg);
+
+	par.dist = dist;
+	par.data = (double *)data;
+	par.length = length;
+	par.nu_c = 0;
+	par.nu_z = 0;
+	par.pdf = (double*) calloc(length, sizeof(double));
+	par.err = (double*) calloc(4 * length, sizeof(double));
+	par.bins = 0;
+	par.edges = NULL;
+	par.counts = NULL;
+
+	if (par.pdf == NULL || par.err == NULL) {
+		perror("Error en la reserva de memoria");
+		free(par.pdf);
+		free(par.err);
+		return -1;
+	}
+
+	theta = gsl_vector_alloc(4);
+	set_expanded(theta, dist->alfa, dist->beta, dist->sigma, dist->mu_0);
 
+	/* Funcion a minimizar y su gradiente */
+	likelihood_func.n = 4;
+	likelihood_func.f = &stable_minusloglikelihood_whole;
+	likelihood_func.df = &_fit_grad_df;
+	likelihood_func.fdf = &_fit_grad_fdf;
+	likelihood_func.params = (void *)(&par);
+
+	T = gsl_multimin_fdfminimizer_vector_bfgs2;
+
+	s = gsl_multimin_fdfminimizer_alloc(T, 4);
+
+	/* Primer salto de 0.01, busqueda lineal con tolerancia 0.1 */
+	gsl_multimin_fdfminimizer_set(s, &likelihood_func, theta, 0.01, 0.1);
+
+	/* Iterar hasta que el gradiente sea menor que FIT_EPSABS sqrt(length):
+	   el error de los parametros es entonces mucho menor que su desviacion
+	   estandar, que decrece como 1 / sqrt(length) */
+	do {
+		iter++;
+		status = gsl_multimin_fdfminimizer_iterate(s);
+
+		if (status != GSL_SUCCESS)
+			break;
+
+		status = gsl_multimin_test_gradient(gsl_multimin_fdfminimizer_gradient(s),
+											cfg.FIT_EPSABS * sqrt(length));
+	} while (status == GSL_CONTINUE && iter < cfg.FIT_MAXITER);
+
+	/* Sin avance en la busqueda lineal: el minimo ya esta dentro de la
+	   precision de la verosimilitud */
+	if (status == GSL_ENOPROG)
+		status = GSL_SUCCESS;
+
+	if (status != GSL_SUCCESS) {
+		printf("Minimizer warning: %s\n", gsl_strerror(status));
+		fflush(stdout);
+	}
+
+	/* Se recupera la estimacion */
+	get_original(gsl_multimin_fdfminimizer_x(s), &a, &b, &c, &m);
+
+	if (stable_setparams(dist, a, b, c, m, 0) < 0) {
+		printf("FINAL ESTIMATED PARAMETER ARE NOT VALID\n  a = %f  b = %f  c = %f  m = %f\n", a, b, c, m);
+		fflush(stdout);
+	}
+
+	gsl_vector_free(theta);
+	gsl_multimin_fdfminimizer_free(s);
+	free(par.err);
+	free(par.pdf);
+
+	return status;
+}
+
+
+/* Stages of stable_fit_mle_stages: the first subsample, its growth factor
+   from one stage to the next and the seed of the subsampling */
+#define STABLE_FIT_STAGE_FIRST 1000
+#define STABLE_FIT_STAGE_GROWTH 10
+#define STABLE_FIT_STAGE_SEED 1
+
+int stable_fit_mle_stages(StableDist *dist, const double *data, const unsigned int length)
+{
+	unsigned long first, last, prev, n, i, j;
+	double *sample, tmp, step;
+	double alfa, beta, sigma, mu_0;
+	struct stable_config cfg;
+	gsl_rng *rng;
+	int status = 0;
+
+	first = length < STABLE_FIT_STAGE_FIRST ? length : STABLE_FIT_STAGE_FIRST;
+
+	/* Subsamples de a lo sumo la mitad de los datos; la ultima etapa es
+	   siempre la muestra completa */
+	for (last = first; 2 * last * STABLE_FIT_STAGE_GROWTH <= length; last *= STABLE_FIT_STAGE_GROWTH);
+
+	sample = malloc(length * sizeof(double));
+	rng = gsl_rng_alloc(gsl_rng_default);
+
+	if (sample == NULL || rng == NULL) {
+		perror("Error en la reserva de memoria");
+		free(sample);
+
+		if (rng != NULL)
+			gsl_rng_free(rng);
+
+		return -1;
+	}
+
+	/* Fisher-Yates parcial: los primeros n datos de sample son una submuestra
+	   aleatoria para cualquier n <= last, y cada una contiene a la anterior */
+	memcpy(sample, data, length * sizeof(double));
+	gsl_rng_set(rng, STABLE_FIT_STAGE_SEED);
+
+	for (i = 0; i < last && i + 1 < length; i++) {
+		j = i + gsl_rng_uniform_int(rng, length - i);
+		tmp = sample[i];
+		sample[i] = sample[j];
+		sample[j] = tmp;
+	}
+
+	gsl_rng_free(rng);
+
+	/* Inicio: McCulloch, refinado con Koutrouvelis, en la primera submuestra */
+	if (stable_fit_init(dist, sample, first, NULL, NULL) < 0) {
+		free(sample);
+		return -1;
+	}
+
+	alfa = dist->alfa;
+	beta = dist->beta;
+	sigma = dist->sigma;
+	mu_0 = dist->mu_0;
+
+	stable_fit_koutrouvelis(dist, sample, first);
+
+	/* Koutrouvelis lleva alfa y beta a los extremos si no converge, donde los
+	   parametros expandidos no son finitos */
+	if (!(dist->alfa > 0.0 && dist->alfa < 2.0 && fabs(dist->beta) < 1.0 &&
+		  dist->sigma > 0.0 && isfinite(dist->mu_0)))
+		stable_setparams(dist, alfa, beta, sigma, mu_0, 0);
+
+	stable_get_config(dist, &cfg);
+
+	/* Cada etapa empieza en la estimacion de la anterior, cuyo error es del
+	   orden de 1 / sqrt(n), con saltos iniciales de ese tamano */
+	for (n = first, prev = first; ; prev = n, n *= STABLE_FIT_STAGE_GROWTH) {
+		step = max(1.0 / sqrt(prev), 2 * cfg.FIT_EPSABS);
+
+		if (n > last || 2 * n > length) {
+#ifdef DEBUG
+			printf("Etapa final: %u muestras\n", length);
+#endif
+			status = _fit_iter_whole(dist, data, length, step);
+			break;
+		}
+
+#ifdef DEBUG
+		printf("Etapa: %lu muestras\n", n);
+#endif
+		_fit_iter_whole(dist, sample, n, step);
+	}
+
+	free(sample);
+
+	return status;
+}
 
 double * load_rand_data(char * filename, int N)
 {
@@ -29,13 +29,72 @@
  */
 #include "stable_api.h"
 #include "stable_integration.h"
+#include "stable_kernels.h"
 
 #include <math.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <pthread.h>
 #include "methods.h"
 
+/* GSL workspaces are owned by the threads instead of the distributions, so
+   any thread can evaluate a shared distribution without copying it. */
+static pthread_key_t workspace_key;
+static pthread_once_t workspace_key_once = PTHREAD_ONCE_INIT;
+
+static void stable_integration_workspace_free(void *workspace)
+{
+	gsl_integration_workspace_free((gsl_integration_workspace *)workspace);
+}
+
+static void stable_integration_workspace_key()
+{
+	pthread_key_create(&workspace_key, stable_integration_workspace_free);
+}
+
+gsl_integration_workspace *stable_integration_workspace(size_t limit)
+{
+	gsl_integration_workspace *workspace;
+
+	pthread_once(&workspace_key_once, stable_integration_workspace_key);
+	workspace = pthread_getspecific(workspace_key);
+
+	if (workspace != NULL && workspace->limit >= limit)
+		return workspace;
+
+	if (workspace != NULL)
+		gsl_integration_workspace_free(workspace);
+
+	workspace = gsl_integration_workspace_alloc(limit);
+	pthread_setspecific(workspace_key, workspace);
+
+	return workspace;
+}
+
+void stable_eval_ctx_init(StableEvalCtx *ctx, const StableDist *dist)
+{
+	double relTOL;
+
+	ctx->dist = dist;
+	ctx->theta0_ = dist->theta0;
+	ctx->beta_ = dist->beta;
+	ctx->xxipow = 0.0;
+
+	stable_get_config(dist, &ctx->cfg);
+	ctx->gslworkspace = stable_integration_workspace(ctx->cfg.IT_MAX);
+
+	relTOL = ctx->cfg.relTOL;
+
+	if (dist->alfa == 1 ? dist->beta < 0 : dist->alfa > 1) {
+		ctx->aux1 = log(log(8.5358 / (relTOL)) / 0.9599); /*3.76;*/
+		ctx->aux2 = log(relTOL); /*-40;*/
+	} else {
+		ctx->aux1 = log(relTOL); /*-40;*/
+		ctx->aux2 = log(log(8.5358 / (relTOL)) / 0.9599); /*3.76;*/
+	}
+}
+
 int stable_integration_METHODNAME(char *name)
 {
 	switch (METHOD) {
@@ -66,6 +125,10 @@ int stable_integration_METHODNAME(char *name)
 		case STABLE_QNG:
 			return sprintf(name,
 						   "GSL_QNG: Non-adaptative Gauss-Kronrod rule 10, 21, 43 and 87 points");
+
+		case STABLE_GK21:
+			return sprintf(name,
+						   "GK21: Adaptative 21 point Gauss-Kronrod rule on node kernels");
 	}
 
 	sprintf(name, "Invalid method");
@@ -73,7 +136,7 @@ int stable_integration_METHODNAME(char *name)
 }
 
 void
-stable_integration_QAG1(StableDist *dist, double(function)(double, void *),
+stable_integration_QAG1(StableEvalCtx *ctx, double(function)(double, void *),
 						double a, double b,
 						double epsabs, double epsrel, unsigned short limit,
 						double *result, double *abserr)
@@ -81,13 +144,13 @@ stable_integration_QAG1(StableDist *dist, double(function)(double, void *),
 	gsl_function F;
 
 	F.function = function;
-	F.params = (void *)dist;
+	F.params = (void *)ctx;
 	gsl_integration_qag(&F, a, b, epsabs, epsrel,
-						limit, 1, dist->gslworkspace, result, abserr);
+						limit, 1, ctx->gslworkspace, result, abserr);
 }
 
 void
-stable_integration_QAG2(StableDist *dist, double(function)(double, void *),
+stable_integration_QAG2(StableEvalCtx *ctx, double(function)(double, void *),
 						double a, double b,
 						double epsabs, double epsrel, unsigned short limit,
 						double *result, double *abserr)
@@ -95,12 +158,12 @@ stable_integration_QAG2(StableDist *dist, double(function)(double, void *),
 	gsl_function F;
 
 	F.function = function;
-	F.params = (void *)dist;
+	F.params = (void *)ctx;
 	gsl_integration_qag(&F, a, b, epsabs, epsrel,
-						limit, 2, dist->gslworkspace, result, abserr);
+						limit, 2, ctx->gslworkspace, result, abserr);
 }
 void
-stable_integration_QAG5(StableDist *dist, double(function)(double, void *),
+stable_integration_QAG5(StableEvalCtx *ctx, double(function)(double, void *),
 						double a, double b,
 						double epsabs, double epsrel, unsigned short limit,
 						double *result, double *abserr)
@@ -108,28 +171,28 @@ stable_integration_QAG5(StableDist *dist, double(function)(double, void *),
 	gsl_function F;
 
 	F.function = function;
-	F.params = (void *)dist;
+	F.params = (void *)ctx;
 	gsl_integration_qag(&F, a, b, epsabs, epsrel,
-						limit, 5, dist->gslworkspace, result, abserr);
+						limit, 5, ctx->gslworkspace, result, abserr);
 }
 
 void
-stable_integration_QUADSTEP(StableDist *dist, double(function)(double, void *),
+stable_integration_QUADSTEP(StableEvalCtx *ctx, double(function)(double, void *),
 							double a, double b,
 							double epsabs, double epsrel, unsigned short limit,
 							double *result, double *abserr)
 {
 	double fa, fc, fb;
 
-	fa = function(a, (void *)dist);
-	fc = function((a + b) * 0.5, (void *)dist);
-	fb = function(b, (void *)dist);
-	*result = quadstep(function, (void *)dist, a, b, fa, fc, fb,
+	fa = function(a, (void *)ctx);
+	fc = function((a + b) * 0.5, (void *)ctx);
+	fb = function(b, (void *)ctx);
+	*result = quadstep(function, (void *)ctx, a, b, fa, fc, fb,
 					   epsabs, epsrel, abserr, NULL, NULL);
 }
 
 void
-stable_integration_QNG(StableDist *dist, double(function)(double, void *),
+stable_integration_QNG(StableEvalCtx *ctx, double(function)(double, void *),
 					   double a, double b,
 					   double epsabs, double epsrel, unsigned short limit,
 					   double *result, double *abserr)
@@ -142,7 +205,7 @@ stable_integration_QNG(StableDist *dist, double(function)(double, void *),
 	//int warn=0;
 
 	F.function = function;
-	F.params = (void *)dist;
+	F.params = (void *)ctx;
 	gsl_integration_qng(&F, a, b, epsabs, epsrel, result, abserr, &fcnt);
 	/*
 	  if(*abserr<=epsabs || *abserr<=epsrel*fabs(*result)) return;
@@ -161,10 +224,10 @@ stable_integration_QNG(StableDist *dist, double(function)(double, void *),
 	          warn+=fcnt;
 	          *result=res_aux;
 	          *abserr=err_aux*err_aux;
-	          stable_integration(dist,function,a,c,fabs(*result*epsrel*0.5),epsrel,limit,&res_aux, &err_aux,STABLE_QAG2);
+	          stable_integration(ctx,function,a,c,fabs(*result*epsrel*0.5),epsrel,limit,&res_aux, &err_aux,STABLE_QAG2);
 	          *result+=res_aux;
 	          *abserr+=err_aux*err_aux;
-	          stable_integration(dist,function,d,b,fabs(*result*epsrel*0.5),epsrel,limit,&res_aux, &err_aux,STABLE_QAG2);
+	          stable_integration(ctx,function,d,b,fabs(*result*epsrel*0.5),epsrel,limit,&res_aux, &err_aux,STABLE_QAG2);
 	          *result+=res_aux;
 	          *abserr+=err_aux*err_aux;
 	          *abserr=sqrt(*abserr);
@@ -180,40 +243,527 @@ stable_integration_QNG(StableDist *dist, double(function)(double, void *),
 	*/
 }
 
+/*
+ * Adaptive 21 point Gauss-Kronrod integration without GSL (STABLE_GK21).
+ *
+ * The nodes of a rule are evaluated in a single call to the node kernel of
+ * the integrand (stable_kernels.h), or to the scalar integrand node by node
+ * when it has none. Each step bisects the interval with the largest error
+ * and evaluates both halves (42 nodes) at once. Intervals are kept in a heap
+ * on the stack, ordered by their error, so no workspace is needed. Errors are
+ * estimated as in QUADPACK qk21.
+ */
+
+#define STABLE_GK21_INTERVALS 512  // Maximum # of intervals (heap size)
+
+static const double _gk21_xgk[11] = {
+	0.995657163025808080735527280689003,
+	0.973906528517171720077964012084452,
+	0.930157491355708226001207180059508,
+	0.865063366688984510732096688423493,
+	0.780817726586416897063717578345042,
+	0.679409568299024406234327365114874,
+	0.562757134668604683339000099272694,
+	0.433395394129247190799265943165784,
+	0.294392862701460198131126603103866,
+	0.148874338981631210884826001129720,
+	0.000000000000000000000000000000000
+};
+
+static const double _gk21_wgk[11] = {
+	0.011694638867371874278064396062192,
+	0.032558162307964727478818972459390,
+	0.054755896574351996031381300244580,
+	0.075039674810919952767043140916190,
+	0.093125454583697605535065465083366,
+	0.109387158802297641899210590325805,
+	0.123491976262065851077208292626231,
+	0.134709217311473325928054001771707,
+	0.142775938577060080797094273138717,
+	0.147739104901338491374841515972068,
+	0.149445554002916905664936468389821
+};
+
+/* Gauss weights of the odd Kronrod nodes */
+static const double _gk21_wg[5] = {
+	0.066671344308688137593568809893332,
+	0.149451349150580593145776339657697,
+	0.219086362515982043995534934228163,
+	0.269266719309996355091226921569469,
+	0.295524224714752870173892994651338
+};
+
+struct _gk21_interval {
+	double a, b;
+	double result, abserr;
+};
+
+static stable_nodes_integrand _gk21_kernel(double(function)(double, void *))
+{
+	if (function == &stable_pdf_g2)
+		return &stable_pdf_g2_nodes;
+	else if (function == &stable_cdf_g2)
+		return &stable_cdf_g2_nodes;
+	else if (function == &stable_pdf_g1)
+		return &stable_pdf_g1_nodes;
+	else if (function == &stable_g_aux2)
+		return &stable_g_aux2_nodes;
+
+	return NULL;
+}
+
+/* Kronrod result and QUADPACK error estimate of the 21 values fk on an
+   interval of half length half */
+static void _gk21_estimate(const double fk[21], double half, double *result, double *abserr)
+{
+	double resk, resg, resabs, resasc, mean, err;
+	int j;
+
+	resk = _gk21_wgk[10] * fk[10];
+	resabs = fabs(resk);
+	resg = 0;
+
+	for (j = 0; j < 10; j++) {
+		resk += _gk21_wgk[j] * (fk[j] + fk[20 - j]);
+		resabs += _gk21_wgk[j] * (fabs(fk[j]) + fabs(fk[20 - j]));
+
+		if (j % 2)
+			resg += _gk21_wg[j / 2] * (fk[j] + fk[20 - j]);
+	}
+
+	mean = 0.5 * resk;
+	resasc = _gk21_wgk[10] * fabs(fk[10] - mean);
+
+	for (j = 0; j < 10; j++)
+		resasc += _gk21_wgk[j] * (fabs(fk[j] - mean) + fabs(fk[20 - j] - mean));
+
+	err = fabs((resk - resg) * half);
+	resasc *= fabs(half);
+	resabs *= fabs(half);
+
+	if (resasc != 0 && err != 0)
+		err = resasc * min(1.0, pow(200 * err / resasc, 1.5));
+
+	if (resabs > GSL_DBL_MIN / (50 * GSL_DBL_EPSILON))
+		err = max(50 * GSL_DBL_EPSILON * resabs, err);
+
+	*result = resk * half;
+	*abserr = err;
+}
+
+/* Nodes of the rule on n intervals */
+static void _gk21_nodes(const double a[], const double b[], int n, double theta[])
+{
+	double c, half;
+	int i, j;
+
+	for (i = 0; i < n; i++) {
+		c = 0.5 * (a[i] + b[i]);
+		half = 0.5 * (b[i] - a[i]);
+
+		for (j = 0; j < 10; j++) {
+			theta[21 * i + j] = c - half * _gk21_xgk[j];
+			theta[21 * i + 20 - j] = c + half * _gk21_xgk[j];
+		}
+
+		theta[21 * i + 10] = c;
+	}
+}
+
+/* Applies the rule on n intervals (1 or 2) */
+static void _gk21_rule(StableEvalCtx *ctx, double(function)(double, void *),
+					   stable_nodes_integrand kernel,
+					   struct _gk21_interval *in[], int n)
+{
+	double theta[42], f[42], a[2], b[2];
+	int i, j;
+
+	for (i = 0; i < n; i++) {
+		a[i] = in[i]->a;
+		b[i] = in[i]->b;
+	}
+
+	_gk21_nodes(a, b, n, theta);
+
+	if (kernel != NULL)
+		(kernel)(ctx, theta, f, 21 * n);
+	else
+		for (j = 0; j < 21 * n; j++)
+			f[j] = (function)(theta[j], (void *)ctx);
+
+	for (i = 0; i < n; i++)
+		_gk21_estimate(f + 21 * i, 0.5 * (b[i] - a[i]), &in[i]->result, &in[i]->abserr);
+}
+
+static void _gk21_sift_down(struct _gk21_interval *heap, int n, int k)
+{
+	struct _gk21_interval aux;
+	int child;
+
+	for (; (child = 2 * k + 1) < n; k = child) {
+		if (child + 1 < n && heap[child + 1].abserr > heap[child].abserr)
+			child++;
+
+		if (heap[k].abserr >= heap[child].abserr)
+			break;
+
+		aux = heap[k];
+		heap[k] = heap[child];
+		heap[child] = aux;
+	}
+}
+
+static void _gk21_sift_up(struct _gk21_interval *heap, int k)
+{
+	struct _gk21_interval aux;
+	int parent;
+
+	for (; k > 0 && heap[parent = (k - 1) / 2].abserr < heap[k].abserr; k = parent) {
+		aux = heap[k];
+		heap[k] = heap[parent];
+		heap[parent] = aux;
+	}
+}
+
 void
-stable_integration(StableDist *dist, double(function)(double, void *),
+stable_integration_GK21(StableEvalCtx *ctx, double(function)(double, void *),
+						double a, double b,
+						double epsabs, double epsrel, unsigned short limit,
+						double *result, double *abserr)
+{
+	struct _gk21_interval heap[STABLE_GK21_INTERVALS], *in[2];
+	stable_nodes_integrand kernel = _gk21_kernel(function);
+	double I, E, m;
+	int n = 1, k, max_n = min(max(limit, 1), STABLE_GK21_INTERVALS);
+
+	heap[0].a = a;
+	heap[0].b = b;
+	in[0] = &heap[0];
+	_gk21_rule(ctx, function, kernel, in, 1);
+
+	I = heap[0].result;
+	E = heap[0].abserr;
+
+	while (E > max(epsabs, epsrel * fabs(I)) && n < max_n) {
+		/* Interval with the largest error, unless it can not be split */
+		m = 0.5 * (heap[0].a + heap[0].b);
+
+		if (!(m > min(heap[0].a, heap[0].b) && m < max(heap[0].a, heap[0].b)))
+			break;
+
+		I -= heap[0].result;
+		E -= heap[0].abserr;
+
+		heap[n].a = m;
+		heap[n].b = heap[0].b;
+		heap[0].b = m;
+
+		in[0] = &heap[0];
+		in[1] = &heap[n];
+		_gk21_rule(ctx, function, kernel, in, 2);
+
+		I += heap[0].result + heap[n].result;
+		E += heap[0].abserr + heap[n].abserr;
+
+		_gk21_sift_down(heap, n, 0);
+		_gk21_sift_up(heap, n);
+		n++;
+	}
+
+	/* Sums again, so the updates do not leave rounding errors */
+	for (k = 0, I = 0, E = 0; k < n; k++) {
+		I += heap[k].result;
+		E += heap[k].abserr;
+	}
+
+	*result = I;
+	*abserr = E;
+}
+
+/*
+ * CDF, PDF and PDF derivative integrals of one point in a single adaptive GK21
+ * pass (stable_integration_pcdf). The three integrands are functions of
+ * g = V(theta) + xxipow, the value of stable_g_aux1/2, which is computed once
+ * per node:
+ *     exp(-e^g)            the CDF integrand (stable_cdf_g1/2)
+ *     e^g exp(-e^g)        the PDF integrand (stable_pdf_g1/2)
+ *     e^2g exp(-e^g)       with which the PDF gives its derivative
+ * The integration starts from the intervals between the given points, which
+ * must hold the peak of the PDF integrand apart, and splits the interval whose
+ * error is largest relative to the tolerance of its integral until all three
+ * are within tolerance.
+ *
+ * The pass for the parameter derivatives (stable_integration_pdf_grad) works
+ * the same way, with the PDF integrand differentiated under the integral:
+ * d/dp e^g exp(-e^g) = dg/dp (e^g - e^2g) exp(-e^g). The integrand vanishes at
+ * both ends of the interval, -theta0_ and pi/2, so their dependence on alfa
+ * and beta adds nothing.
+ */
+
+#define STABLE_PCDF_INTERVALS 128  // Maximum # of intervals of the joint pass
+#define STABLE_PCDF_INTEGRALS 4    // Maximum # of integrals of the joint pass
+
+struct _pcdf_interval {
+	double a, b;
+	double result[STABLE_PCDF_INTEGRALS], abserr[STABLE_PCDF_INTEGRALS];
+};
+
+/* Integrals of a joint pass on up to two intervals */
+typedef void (*_pcdf_rule_fn)(StableEvalCtx *ctx, const double *params,
+							  struct _pcdf_interval *in[], int n);
+
+static void _pcdf_rule(StableEvalCtx *ctx, const double *params,
+					   struct _pcdf_interval *in[], int n)
+{
+	double theta[42], g[42], f[3][42], a[2] = {0, 0}, b[2] = {0, 0}, e, c;
+	int i, j, l;
+
+	for (i = 0; i < n; i++) {
+		a[i] = in[i]->a;
+		b[i] = in[i]->b;
+	}
+
+	_gk21_nodes(a, b, n, theta);
+
+	if (ctx->dist->ZONE == ALFA_1)
+		for (j = 0; j < 21 * n; j++)
+			g[j] = stable_g_aux1(theta[j], (void *)ctx);
+	else
+		stable_g_aux2_nodes(ctx, theta, g, 21 * n);
+
+	for (j = 0; j < 21 * n; j++) {
+		e = stable_vm_exp(g[j]);
+		c = e < 1.522e-8 ? 1.0 - e : stable_vm_exp(-e);
+
+		/* exp(g - e^g) < 2.1e-301 beyond g = 6.55, and NaN is left out */
+		f[0][j] = g[j] == g[j] ? c : 0.0;
+		f[1][j] = g[j] <= 6.55 ? e * c : 0.0;
+		f[2][j] = g[j] <= 6.55 ? e * e * c : 0.0;
+	}
+
+	for (i = 0; i < n; i++)
+		for (l = 0; l < 3; l++)
+			_gk21_estimate(f[l] + 21 * i, 0.5 * (b[i] - a[i]),
+						   &in[i]->result[l], &in[i]->abserr[l]);
+}
+
+/* PDF integrand, e^g times it and its derivatives with respect to the two
+   parameters whose coefficients of d log(V) / dp are in params */
+static void _grad_rule(StableEvalCtx *ctx, const double *params,
+					   struct _pcdf_interval *in[], int n)
+{
+	const StableDist *dist = ctx->dist;
+	double theta[42], g[42], f[4][42], a[2] = {0, 0}, b[2] = {0, 0}, e, c, w, t, phi, L, T, d0, d1;
+	int i, j, l;
+
+	for (i = 0; i < n; i++) {
+		a[i] = in[i]->a;
+		b[i] = in[i]->b;
+	}
+
+	_gk21_nodes(a, b, n, theta);
+	stable_g_aux2_nodes(ctx, theta, g, 21 * n);
+
+	for (j = 0; j < 21 * n; j++) {
+		e = stable_vm_exp(g[j]);
+		c = e < 1.522e-8 ? 1.0 - e : stable_vm_exp(-e);
+		f[0][j] = g[j] <= 6.55 ? e * c : 0.0;
+		f[1][j] = g[j] <= 6.55 ? e * e * c : 0.0;
+		w = f[0][j] - f[1][j];
+
+		t = ctx->theta0_ + theta[j];
+		phi = dist->alfa * t;
+		L = stable_vm_log(stable_vm_cos(theta[j]) / stable_vm_sin(phi));
+		T = dist->alfainvalfa1 * stable_vm_cos(phi) / stable_vm_sin(phi) +
+			stable_vm_sin(phi - theta[j]) / stable_vm_cos(phi - theta[j]);
+
+		/* d log(V) / dp is unbounded at the ends, where w vanishes first.
+		   d w - d w is 0 unless d w is not finite, which keeps the loop free
+		   of calls */
+		d0 = (params[0] * L - (params[1] * t + params[2]) * T + params[3]) * w;
+		d1 = (params[4] * L - (params[5] * t + params[6]) * T + params[7]) * w;
+		f[2][j] = w != 0.0 && d0 - d0 == 0.0 ? d0 : 0.0;
+		f[3][j] = w != 0.0 && d1 - d1 == 0.0 ? d1 : 0.0;
+	}
+
+	for (i = 0; i < n; i++)
+		for (l = 0; l < 4; l++)
+			_gk21_estimate(f[l] + 21 * i, 0.5 * (b[i] - a[i]),
+						   &in[i]->result[l], &in[i]->abserr[l]);
+}
+
+/* Adaptive joint pass of the m integrals of rule. The tolerance of each one
+   is relative to itself or, if larger, to integral ref (none if ref < 0) */
+static void _pcdf_integration(StableEvalCtx *ctx, _pcdf_rule_fn rule, const double *params,
+							  int m, int ref, const double theta[], int n_theta,
+							  double epsabs, double epsrel, unsigned short limit,
+							  double result[], double abserr[])
+{
+	struct _pcdf_interval list[STABLE_PCDF_INTERVALS], *in[2];
+	int n, k, l, worst, max_n = min(max(limit, n_theta), STABLE_PCDF_INTERVALS);
+	double tol, ratio, worst_ratio, c;
+
+	/* Initial intervals between the given points, two at a time */
+	for (n = 0; n < n_theta - 1; n++) {
+		list[n].a = theta[n];
+		list[n].b = theta[n + 1];
+	}
+
+	for (k = 0; k < n; k += 2) {
+		in[0] = &list[k];
+		in[1] = &list[k + 1];
+		rule(ctx, params, in, min(n - k, 2));
+	}
+
+	for (;;) {
+		for (l = 0; l < m; l++) {
+			result[l] = 0;
+			abserr[l] = 0;
+
+			for (k = 0; k < n; k++) {
+				result[l] += list[k].result[l];
+				abserr[l] += list[k].abserr[l];
+			}
+		}
+
+		/* Interval with the largest error relative to the tolerance of any
+		   of the integrals that has not converged yet */
+		for (k = 0, worst = -1, worst_ratio = 0; k < n; k++) {
+			for (l = 0; l < m; l++) {
+				tol = max(epsabs, epsrel * max(fabs(result[l]), ref >= 0 ? fabs(result[ref]) : 0.0));
+
+				if (abserr[l] <= tol)
+					continue;
+
+				ratio = list[k].abserr[l] / tol;
+
+				if (ratio > worst_ratio) {
+					worst_ratio = ratio;
+					worst = k;
+				}
+			}
+		}
+
+		if (worst < 0 || n >= max_n)
+			break;
+
+		c = 0.5 * (list[worst].a + list[worst].b);
+
+		if (!(c > min(list[worst].a, list[worst].b) && c < max(list[worst].a, list[worst].b)))
+			break;
+
+		list[n].a = c;
+		list[n].b = list[worst].b;
+		list[worst].b = c;
+
+		in[0] = &list[worst];
+		in[1] = &list[n];
+		rule(ctx, params, in, 2);
+		n++;
+	}
+}
+
+void
+stable_integration_pcdf(StableEvalCtx *ctx, const double theta[], int n_theta,
+						double epsabs, double epsrel, unsigned short limit,
+						double result[3], double abserr[3])
+{
+	_pcdf_integration(ctx, _pcdf_rule, NULL, 3, -1, theta, n_theta,
+					  epsabs, epsrel, limit, result, abserr);
+}
+
+void
+stable_integration_pdf_grad(StableEvalCtx *ctx, const double dv[2][4],
+							const double theta[], int n_theta,
+							double epsabs, double epsrel, unsigned short limit,
+							double result[4], double abserr[4])
+{
+	/* The derivatives only matter next to the PDF, which may be larger */
+	_pcdf_integration(ctx, _grad_rule, &dv[0][0], 4, 0, theta, n_theta,
+					  epsabs, epsrel, limit, result, abserr);
+}
+
+int stable_integration_peak(StableEvalCtx *ctx, double(*auxiliar)(double, void *),
+							double theta[5])
+{
+	double ends[3], g_left, g_right;
+	int warn, n = 0;
+
+	ends[0] = -ctx->theta0_ + ctx->cfg.THETA_TH;
+	ends[2] = M_PI_2 - ctx->cfg.THETA_TH;
+	ends[1] = zbrent(auxiliar, (void *)ctx, ends[0], ends[2], 0.0,
+					 1e-6 * (ends[2] - ends[0]), &warn);
+
+	theta[n++] = ends[0];
+
+	/* Points where the PDF integrand becomes negligible on each side, as in
+	   stable_integration_pdf, so its peak has intervals of its own */
+	if (warn == 0) {
+		g_left = auxiliar(ends[0], (void *)ctx) < 0 ? min(ctx->aux1, ctx->aux2) : max(ctx->aux1, ctx->aux2);
+		g_right = g_left == ctx->aux1 ? ctx->aux2 : ctx->aux1;
+
+		theta[n] = zbrent(auxiliar, (void *)ctx, ends[0], ends[1], g_left,
+						  1e-6 * (ends[1] - ends[0]), &warn);
+
+		if (warn == 0 && theta[n] > ends[0])
+			n++;
+
+		theta[n++] = ends[1];
+
+		theta[n] = zbrent(auxiliar, (void *)ctx, ends[1], ends[2], g_right,
+						  1e-6 * (ends[2] - ends[1]), &warn);
+
+		if (warn == 0 && theta[n] < ends[2])
+			n++;
+	}
+
+	theta[n++] = ends[2];
+
+	return n;
+}
+
+void
+stable_integration(StableEvalCtx *ctx, double(function)(double, void *),
 				   double a, double b,
 				   double epsabs, double epsrel, unsigned short limit,
 				   double *result, double *abserr, unsigned short method)
 {
 
+	/* STABLE_GK21 as METHOD replaces the rule of every subinterval */
+	if (ctx->cfg.METHOD == STABLE_GK21)
+		method = STABLE_GK21;
+
 	switch (method) {
+		case STABLE_GK21:
+			stable_integration_GK21(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
+			break;
+
 		case STABLE_QAG2:
-			stable_integration_QAG2(dist, function, a, b, epsabs, epsrel, limit, result, abserr);
+			stable_integration_QAG2(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
 			break;
 
 		case STABLE_QUADSTEP:
-			stable_integration_QUADSTEP(dist, function, a, b, epsabs, epsrel, limit, result, abserr);
+			stable_integration_QUADSTEP(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
 			break;
 
 		case STABLE_QROMBPOL:
-			*result = qromb(function, (void *)dist, a, b, epsabs, epsrel, 4, 10, 1, NULL, NULL, abserr);
+			*result = qromb(function, (void *)ctx, a, b, epsabs, epsrel, 4, 10, 1, NULL, NULL, abserr);
 			break;
 
 		case STABLE_QROMBRAT:
-			*result = qromb(function, (void *)dist, a, b, epsabs, epsrel, 4, 10, 2, NULL, NULL, abserr);
+			*result = qromb(function, (void *)ctx, a, b, epsabs, epsrel, 4, 10, 2, NULL, NULL, abserr);
 			break;
 
 		case STABLE_QNG:
-			stable_integration_QNG(dist, function, a, b, epsabs, epsrel, limit, result, abserr);
+			stable_integration_QNG(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
 			break;
 
 		case STABLE_QAG1:
-			stable_integration_QAG1(dist, function, a, b, epsabs, epsrel, limit, result, abserr);
+			stable_integration_QAG1(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
 			break;
 
 		case STABLE_QAG5:
-			stable_integration_QAG5(dist, function, a, b, epsabs, epsrel, limit, result, abserr);
+			stable_integration_QAG5(ctx, function, a, b, epsabs, epsrel, limit, result, abserr);
 			break;
 	}
 }
@@ -32,129 +32,154 @@
  */
 #include "stable_api.h"
 #include "stable_integration.h"
-#include <gsl/gsl_roots.h>
+#include "stable_kernels.h"
 #include <gsl/gsl_cdf.h>
 
 #include "methods.h"
-#include <pthread.h>
-#include "stable_inv_precalcs.h"
+#include "stable_pool.h"
+#include "stable_inv_table.h"
 
-double stable_quick_inv_point(StableDist *dist, const double q, double *err)
+/* Slope at a node of the Steffen cubic, from the slopes of the adjacent
+   intervals (unit spacing). It keeps the interpolation monotone. */
+static double _steffen_slope(double a, double b)
 {
-	double x0 = 0;
-	double C = 0;
-	double alfa = dist->alfa;
-	double beta = dist->beta;
-	double q_ = q;
-	double signBeta = 1;
+	if (a * b <= 0)
+		return 0.0;
 
-	if (alfa < 0.1)   alfa = 0.1;
+	return (a > 0 ? 2.0 : -2.0) * min(min(fabs(a), fabs(b)), 0.25 * fabs(a + b));
+}
 
-	if (beta < 0) {
-		signBeta = -1;
-		q_ = 1.0 - q_;
-		beta = -beta;
-	}
+/* Interpolation at t in [0, 1] between y[1] and y[2], nodes at -1, 0, 1, 2 */
+static double _steffen(const double y[4], double t)
+{
+	double m1 = _steffen_slope(y[1] - y[0], y[2] - y[1]);
+	double m2 = _steffen_slope(y[2] - y[1], y[3] - y[2]);
+	double t2 = t * t, t3 = t2 * t;
 
-	if (beta == 1) {
-		if (q_ < 0.1)
-			q_ = 0.1;
-	}
+	return (2 * t3 - 3 * t2 + 1) * y[1] + (t3 - 2 * t2 + t) * m1 +
+		   (3 * t2 - 2 * t3) * y[2] + (t3 - t2) * m2;
+}
 
-	/* Asympthotic expansion near the limits of the domain */
-	if (q_ > 0.9 || q_ < 0.1) {
-		if (alfa != 1.0)
-			C = (1 - alfa) / (exp(gammaln(2 - alfa)) * cos(M_PI * alfa / 2.0));
-		else
-			C = 2 / M_PI;
+/* Nodes i - 1 .. i + 2 around coordinate c (in steps) of an axis of n nodes.
+   Missing nodes at the ends are marked with -1. */
+static double _axis_nodes(double c, int n, int idx[4])
+{
+	int i = (int)floor(c), j;
 
-		if (q_ > 0.9)
-			x0 = pow((1 - q_) / (C * 0.5 * (1.0 + beta)), -1.0 / alfa);
-		else
-			x0 = -pow(q_ / (C * 0.5 * (1.0 - beta)), -1.0 / alfa);
+	i = i < 0 ? 0 : (i > n - 2 ? n - 2 : i);
 
-		*err = 0.1;
-	}
+	for (j = 0; j < 4; j++)
+		idx[j] = i - 1 + j < 0 || i - 1 + j >= n ? -1 : i - 1 + j;
 
-	else {
-		/* Linear interpolation on precalculated values */
-		int ia, ib, iq;
-		double aux = 0;
-		double xa = modf(alfa / 0.1, &aux);
-		ia = (int)aux - 1;
-		double xb = modf(beta / 0.2, &aux);
-		ib = (int)aux;
-		double xq = modf(q_ / 0.1, &aux);
-		iq = (int)aux - 1;
-
-		if (alfa == 2) {
-			ia = 18;
-			xa = 1.0;
-		}
+	c -= i;
 
-		if (beta == 1) {
-			ib = 4;
-			xb = 1.0;
-		}
+	return c < 0 ? 0 : (c > 1 ? 1 : c);
+}
 
-		if (q_ == 0.9) {
-			iq = 7;
-			xq = 1.0;
-		}
+/* Linear extrapolation of missing nodes */
+static void _axis_fill(const int idx[4], double y[4])
+{
+	if (idx[0] < 0)
+		y[0] = 2 * y[1] - y[2];
 
-		double p[8] = {precalc[iq][ib][ia],   precalc[iq][ib][ia + 1],   precalc[iq][ib + 1][ia],   precalc[iq][ib + 1][ia + 1],
-					   precalc[iq + 1][ib][ia], precalc[iq + 1][ib][ia + 1], precalc[iq + 1][ib + 1][ia], precalc[iq + 1][ib + 1][ia + 1]
-					  };
+	if (idx[3] < 0)
+		y[3] = 2 * y[2] - y[1];
+}
 
-		//Trilinear interpolation
-		x0 = ((p[0] * (1.0 - xa) + p[1] * xa) * (1 - xb) + (p[2] * (1 - xa) + p[3] * xa) * xb) * (1 - xq) + ((p[4] * (1.0 - xa) + p[5] * xa) * (1 - xb) + (p[6] * (1 - xa) + p[7] * xa) * xb) * xq;
+static double _table_asinh(const double *table, double ca, double cb, double cu)
+{
+	int ia[4], ib[4], iu[4], ja, jb, ju;
+	double ta, tb, tu, ya[4], yb[4], yu[4];
 
-		if (err != NULL)
-			*err = fabs(0.5 * (p[0] - p[1]));
+	ta = _axis_nodes(ca, STABLE_INV_TABLE_NA, ia);
+	tb = _axis_nodes(cb, STABLE_INV_TABLE_NB, ib);
+	tu = _axis_nodes(cu, STABLE_INV_TABLE_NU, iu);
 
-#ifdef DEBUG
-		printf("Quickinv: %f %f %f %d %d %d %f %f %f\n", alfa, beta, q_, ia, ib, iq, xa, xb, xq);
-		printf("Precalc: \t %1.6e %1.6e \t\t %1.6e %1.6e\n\t\t %1.6e %1.6e \t\t %1.6e %1.6e", p[0], p[1], p[2], p[3], p[4], p[5], p[6], p[7]);
-#endif
+	for (ja = 0; ja < 4; ja++) {
+		if (ia[ja] < 0)
+			continue;
+
+		for (jb = 0; jb < 4; jb++) {
+			if (ib[jb] < 0)
+				continue;
+
+			for (ju = 0; ju < 4; ju++)
+				if (iu[ju] >= 0)
+					yu[ju] = table[STABLE_INV_TABLE_INDEX(ia[ja], ib[jb], iu[ju])];
+
+			_axis_fill(iu, yu);
+			yb[jb] = _steffen(yu, tu);
+		}
+
+		_axis_fill(ib, yb);
+		ya[ja] = _steffen(yb, tb);
 	}
 
-	x0 = x0 * signBeta * dist->sigma + dist->mu_0;
+	_axis_fill(ia, ya);
 
-	return x0;
+	return _steffen(ya, ta);
 }
 
-typedef struct {
-	StableDist *dist;
-	double q;
-} rootparams;
+/* Grid coordinates (in steps) of alfa and beta >= 0, clamped to the grid */
+static double _coord_alfa(double alfa)
+{
+	alfa = alfa < STABLE_INV_TABLE_ALFA_MIN ? STABLE_INV_TABLE_ALFA_MIN :
+		   (alfa > STABLE_INV_TABLE_ALFA_MAX ? STABLE_INV_TABLE_ALFA_MAX : alfa);
 
-double f_wrap(double x, void * params)
+	return (STABLE_INV_TABLE_ALFA_COORD(alfa) - STABLE_INV_TABLE_ALFA_COORD(STABLE_INV_TABLE_ALFA_MIN)) /
+		   (STABLE_INV_TABLE_ALFA_COORD(STABLE_INV_TABLE_ALFA_MAX) -
+			STABLE_INV_TABLE_ALFA_COORD(STABLE_INV_TABLE_ALFA_MIN)) * (STABLE_INV_TABLE_NA - 1);
+}
+
+static double _coord_beta(double beta)
 {
-	rootparams *par = (rootparams *)params;
-	double y = stable_cdf_point(par->dist, x, NULL) - par->q;
-#ifdef DEBUG
-	printf("F(%e)=%e\n", x, y);
-#endif
-	return y;
+	beta = beta > 1.0 ? 1.0 : beta;
+
+	return (STABLE_INV_TABLE_BETA_COORD(beta) - STABLE_INV_TABLE_BETA_COORD(0.0)) /
+		   (STABLE_INV_TABLE_BETA_COORD(1.0) - STABLE_INV_TABLE_BETA_COORD(0.0)) * (STABLE_INV_TABLE_NB - 1);
 }
-double df_wrap(double x, void * params)
+
+double stable_inv_guess_interp(const double *table, double alfa, double beta, double q)
 {
-	rootparams *par = (rootparams *)params;
-	double dy = stable_pdf_point(par->dist, x, NULL);
-#ifdef DEBUG
-	printf("dF(%e)=%e\n", x, dy);
-#endif
-	return dy;
+	const double u_max = STABLE_INV_TABLE_U_MIN + (STABLE_INV_TABLE_NU - 1) * STABLE_INV_TABLE_U_STEP;
+	double p = q, pc = 1.0 - q, sign = 1.0, u, x, p_end;
+
+	if (beta < 0) {
+		p = pc;
+		pc = q;
+		beta = -beta;
+		sign = -1.0;
+	}
+
+	alfa = min(max(alfa, STABLE_INV_TABLE_ALFA_MIN), STABLE_INV_TABLE_ALFA_MAX);
+	u = log(p / pc);
+	x = sinh(_table_asinh(table, _coord_alfa(alfa), _coord_beta(beta),
+						  (u - STABLE_INV_TABLE_U_MIN) / STABLE_INV_TABLE_U_STEP) / alfa);
+
+	/* Power law tails beyond the grid, but for the light one of beta = 1 */
+	if (u < STABLE_INV_TABLE_U_MIN && beta < 1.0) {
+		p_end = 1.0 / (1.0 + exp(-STABLE_INV_TABLE_U_MIN));
+		x *= pow(p / p_end, -1.0 / alfa);
+	} else if (u > u_max) {
+		p_end = 1.0 / (1.0 + exp(u_max));
+		x *= pow(pc / p_end, -1.0 / alfa);
+	}
+
+	return sign * x;
 }
-void fdf_wrap(double x, void * params, double * f, double * df)
+
+double stable_quick_inv_point(const StableDist *dist, const double q, double *err)
 {
-	rootparams *par = (rootparams *)params;
-	*f  = stable_cdf_point(par->dist, x, NULL) - par->q;
-	*df = stable_pdf_point(par->dist, x, NULL);
-#ifdef DEBUG
-	printf("Fdf(%e)=(%e,%e)\n", x, *f, *df);
-#endif
-	return;
+	double x0 = stable_inv_guess_interp(stable_inv_guess, dist->alfa, dist->beta, q);
+	int ia, ib;
+
+	if (err != NULL) {
+		ia = min((int)_coord_alfa(dist->alfa), STABLE_INV_TABLE_NA - 2);
+		ib = min((int)_coord_beta(fabs(dist->beta)), STABLE_INV_TABLE_NB - 2);
+		*err = stable_inv_guess_err[ia * (STABLE_INV_TABLE_NB - 1) + ib] * sqrt(1 + x0 * x0) * dist->sigma;
+	}
+
+	return x0 * dist->sigma + dist->mu_0;
 }
 
 static short _is_guess_valid(double val)
@@ -252,153 +277,395 @@ double stable_inv_point_gpu(StableDist* dist, const double q, double *err)
 	return guess;
 }
 
-double stable_inv_point(StableDist *dist, const double q, double *err)
+/* Quantile solver state kept between iterations: the maximum of the PDF
+   integrand found by zbrent and the points around it where the integrand
+   becomes negligible, with V(theta) at the maximum, on the side of xi given
+   by theta0_. V does not depend on x, so whether the maximum is still close
+   at the next iterate is known without evaluating the integrand. */
+struct _inv_state {
+	double theta[5];
+	int n_theta;
+	double v_max;
+	double theta0_;
+	short valid;
+};
+
+/* CDF, PDF and derivative of the PDF of the standard distribution at x_,
+   integrated in a single pass. Returns 0, with nothing computed, where the
+   series or the special cases of stable_cdf_point replace the integration. */
+static short _inv_pcdf_std(const StableDist *dist, double x_, struct _inv_state *st,
+						   double *cdf, double *pdf, double *dpdf)
 {
-	double x, x0 = 0;
+	StableEvalCtx ctx;
+	double(*auxiliar)(double, void *);
+	double xxi, v, e, r[3], abserr[3], sign;
+
+	stable_eval_ctx_init(&ctx, dist);
+
+	if (dist->ZONE == STABLE) {
+		xxi = x_ - dist->xi;
+
+		if (fabs(xxi) <= ctx.cfg.XXI_TH ||
+			((ctx.cfg.EVAL_MODE & STABLE_EVAL_CENTER) &&
+			 stable_center_series_point(&dist->center[CDF], xxi, ctx.cfg.relTOL, &v, &e)))
+			return 0;
+
+		sign = xxi < 0 ? -1.0 : 1.0;
+		ctx.theta0_ = sign * dist->theta0;
+		ctx.beta_ = sign * dist->beta;
+
+		if (fabs(ctx.theta0_ + M_PI_2) < 2 * ctx.cfg.THETA_TH)
+			return 0;
+
+		ctx.xxipow = dist->alfainvalfa1 * log(fabs(xxi));
+		auxiliar = &stable_g_aux2;
+	} else if (dist->ZONE == ALFA_1) {
+		xxi = x_;
+		sign = dist->beta < 0 ? -1.0 : 1.0;
+		ctx.beta_ = fabs(dist->beta);
+		ctx.xxipow = -M_PI * sign * x_ * dist->c2_part;
+		auxiliar = &stable_g_aux1;
+	} else
+		return 0;
 
-	gsl_root_fdfsolver * fdfsolver;
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_TAILS) &&
+		stable_tail_series_point(&dist->tail[CDF][xxi < 0], fabs(xxi), ctx.cfg.relTOL, &v, &e))
+		return 0;
 
-	// Casos particulares
-	if (dist->ZONE == GAUSS) {
-		x = gsl_cdf_ugaussian_Pinv(q) * M_SQRT2 * dist->sigma + dist->mu_0;
-		return x;
-	} else if (dist->ZONE == CAUCHY) {
-		x = tan(M_PI * (q - 0.5)) * dist->sigma + dist->mu_0;
-		return x;
-	} else if (dist->ZONE == LEVY) {
-		x = (dist->beta * pow(gsl_cdf_ugaussian_Pinv(q / 2.0), -2.0) + dist->xi) * dist->sigma + dist->mu_0;
-		return x;
+	/* The maximum, where g = V + xxipow = 0, moves little from one iterate to
+	   the next, so it is only searched again when the last one is far off */
+	if (!st->valid || st->theta0_ != ctx.theta0_ || fabs(st->v_max + ctx.xxipow) >= 1.0) {
+		st->n_theta = stable_integration_peak(&ctx, auxiliar, st->theta);
+		st->valid = st->n_theta > 2;
+		st->v_max = -ctx.xxipow;
+		st->theta0_ = ctx.theta0_;
 	}
 
-	x = stable_quick_inv_point(dist, q, err);
+	stable_integration_pcdf(&ctx, st->theta, st->n_theta, ctx.cfg.absTOL, ctx.cfg.relTOL,
+							ctx.cfg.IT_MAX, r, abserr);
 
-	rootparams params;
-	params.dist = dist;
-	params.q = q;
+	if (dist->ZONE == ALFA_1) {
+		/* g decreases with x at a rate pi c2_part */
+		*cdf = sign > 0 ? dist->c3 * r[0] : 1.0 - dist->c3 * r[0];
+		*pdf = dist->c2_part * r[1];
+		*dpdf = -sign * M_PI * dist->c2_part * dist->c2_part * (r[1] - r[2]);
+	} else {
+		if (xxi > 0)
+			*cdf = dist->c1 + dist->c3 * r[0];
+		else if (dist->alfa > 1.0)
+			*cdf = -dist->c3 * r[0];
+		else
+			*cdf = 0.5 - (dist->theta0 + r[0]) * M_1_PI;
 
-	gsl_function_fdf fdf;
-	fdf.f   = f_wrap;
-	fdf.df  = df_wrap;
-	fdf.fdf = fdf_wrap;
-	fdf.params = (void*)&params;
+		/* g grows with log|xxi| at a rate alfa/(alfa-1) */
+		xxi = fabs(xxi);
+		*pdf = dist->c2_part / xxi * r[1];
+		*dpdf = sign * dist->c2_part / (xxi * xxi) *
+				(dist->alfainvalfa1 * (r[1] - r[2]) - r[1]);
+	}
 
-	//  gsl_function f;
-	//  f.function = f_wrap;
-	//  f.params = (void*)&params;
+	return 1;
+}
 
-	int status;
+/* CDF, PDF and its derivative (NaN if not known) at x */
+static void _inv_pcdf(const StableDist *dist, double x, struct _inv_state *st,
+					  double *cdf, double *pdf, double *dpdf)
+{
+	double x_ = (x - dist->mu_0) / dist->sigma;
 
-	if (INV_MAXITER > 0) {
-		fdfsolver = gsl_root_fdfsolver_alloc(gsl_root_fdfsolver_secant);
-		gsl_root_fdfsolver_set(fdfsolver, & fdf, x);
+	if (_inv_pcdf_std(dist, x_, st, cdf, pdf, dpdf)) {
+		*pdf /= dist->sigma;
+		*dpdf /= dist->sigma * dist->sigma;
+	} else {
+		*cdf = stable_cdf_point(dist, x, NULL);
+		*pdf = stable_pdf_point(dist, x, NULL);
+		*dpdf = NAN;
+	}
+}
 
-		//    fsolver = gsl_root_fsolver_alloc(gsl_root_fsolver_falsepos);
-		//    gsl_root_fsolver_set (fsolver, & f, x_lower , x_upper);
+/* What a solve leaves for the next quantile of a sorted batch: the closest
+   points known below (cdf_lo < q) and above (cdf_hi > q) the root, and the
+   last point evaluated, with its CDF, PDF and PDF derivative */
+struct _inv_chain {
+	double lo, cdf_lo, hi, cdf_hi;
+	double x, cdf, pdf, dpdf;
+	short known;
+};
 
-		int k = 0;
-		double INVrelTOL = 1e-6;
+static void _inv_chain_init(struct _inv_chain *ch)
+{
+	ch->lo = -INFINITY;
+	ch->cdf_lo = 0.0;
+	ch->hi = INFINITY;
+	ch->cdf_hi = 1.0;
+	ch->known = 0;
+}
 
-		do {
-			k++;
-			status = gsl_root_fdfsolver_iterate(fdfsolver);
-			x0 = x;
-			x = gsl_root_fdfsolver_root(fdfsolver);
-			status = gsl_root_test_delta(x, x0, 0, INVrelTOL);
-		} while (status == GSL_CONTINUE && k < INV_MAXITER);
+/* The quantile is solved with Halley (or Newton) steps from the guess of
+   stable_quick_inv_point, with the CDF, PDF and PDF derivative of each iterate
+   from one integration. The iterates bracket the root: a step that falls out
+   of the bracket is replaced by a bisection, or while one end is still
+   unknown, by a growing step towards it, so the solver can not diverge.
+
+   In a batch, the points of the chain that still bound q start the bracket,
+   and a Halley step from the last point evaluated replaces the guess when it
+   is expected to be closer. */
+static double _inv_solve(const StableDist *dist, const struct stable_config *cfg,
+						 double q, struct _inv_state *st, struct _inv_chain *ch, double *err)
+{
+	double x, xn, dx = 0, h, step, cdf, pdf, dpdf, tol;
+	const double INVrelTOL = 1e-6;
+	int k;
 
-		gsl_root_fdfsolver_free(fdfsolver);
+	x = stable_quick_inv_point(dist, q, err);
+
+	if (cfg->INV_MAXITER == 0 || !(q > 0 && q < 1))
+		return x;
+
+	if (!(ch->cdf_lo < q)) {
+		ch->lo = -INFINITY;
+		ch->cdf_lo = 0.0;
 	}
 
-#ifdef DEBUG
+	if (!(ch->cdf_hi > q)) {
+		ch->hi = INFINITY;
+		ch->cdf_hi = 1.0;
+	}
 
-	if (status == GSL_SUCCESS)
-		printf("convergence at x = %e\n", x);
-	else
-		printf("didn't converge\n");
+	if (ch->known) {
+		dx = (q - ch->cdf) / ch->pdf;
+		h = 1.0 + 0.5 * dx * ch->dpdf / ch->pdf;
+
+		/* The size of the Halley correction (or of the whole step, without
+		   the PDF derivative) bounds the error of the step */
+		tol = h > 0.5 && h < 2.0 ? fabs((h - 1.0) * dx) : fabs(dx);
+		xn = h > 0.5 && h < 2.0 ? ch->x + dx / h : ch->x + dx;
+
+		if (tol < *err && xn > ch->lo && xn < ch->hi) {
+			*err = max(tol, INVrelTOL * max(fabs(xn), dist->sigma));
+			x = xn;
+		}
+	}
+
+	step = max(*err, INVrelTOL * max(fabs(x), dist->sigma));
+
+	if (!(x > ch->lo && x < ch->hi)) {
+		if (isfinite(ch->lo) && isfinite(ch->hi))
+			x = 0.5 * (ch->lo + ch->hi);
+		else
+			x = isfinite(ch->lo) ? ch->lo + step : ch->hi - step;
+	}
 
+	for (k = 0; k < cfg->INV_MAXITER; k++) {
+		_inv_pcdf(dist, x, st, &cdf, &pdf, &dpdf);
+
+		if (pdf > 0 && isfinite(pdf)) {
+			/* Where the series give no derivative, the difference with the
+			   previous point is close enough for the next guess */
+			if (!isfinite(dpdf) && ch->known && x != ch->x)
+				ch->dpdf = (pdf - ch->pdf) / (x - ch->x);
+			else
+				ch->dpdf = dpdf;
+
+			ch->x = x;
+			ch->cdf = cdf;
+			ch->pdf = pdf;
+			ch->known = 1;
+		}
+
+		if (cdf == q) {
+			dx = 0;
+			break;
+		}
+
+		if (cdf < q) {
+			ch->lo = x;
+			ch->cdf_lo = cdf;
+		} else {
+			ch->hi = x;
+			ch->cdf_hi = cdf;
+		}
+
+		dx = (q - cdf) / pdf;
+		h = 1.0 + 0.5 * dx * dpdf / pdf;
+
+		if (h > 0.5 && h < 2.0)
+			dx /= h;
+
+		xn = x + dx;
+
+		if (!(xn > ch->lo && xn < ch->hi)) {
+			if (isfinite(ch->lo) && isfinite(ch->hi))
+				xn = 0.5 * (ch->lo + ch->hi);
+			else {
+				xn = cdf < q ? x + step : x - step;
+				step *= 4;
+			}
+		}
+
+		dx = xn - x;
+		x = xn;
+		tol = INVrelTOL * max(fabs(x), dist->sigma);
+
+		if (fabs(dx) <= tol || ch->hi - ch->lo <= tol)
+			break;
+	}
+
+	*err = fabs(dx);
+
+#ifdef DEBUG
+	printf("%s at x = %e after %d iterations\n", k < cfg->INV_MAXITER ? "convergence" : "no convergence", x, k);
 #endif
 
 	return x;
 }
 
+/* Closed forms of the particular cases, or 0 if there is none */
+static short _inv_exact(const StableDist *dist, const double q, double *x)
+{
+	if (dist->ZONE == GAUSS)
+		*x = gsl_cdf_ugaussian_Pinv(q) * M_SQRT2 * dist->sigma + dist->mu_0;
+	else if (dist->ZONE == CAUCHY)
+		*x = tan(M_PI * (q - 0.5)) * dist->sigma + dist->mu_0;
+	else if (dist->ZONE == LEVY)
+		*x = (dist->beta * pow(gsl_cdf_ugaussian_Pinv((dist->beta > 0 ? q : 1.0 - q) / 2.0), -2.0)
+			  + dist->xi) * dist->sigma + dist->mu_0;
+	else
+		return 0;
+
+	return 1;
+}
 
-void * thread_init_inv(void *ptr_args)
+double stable_inv_point(const StableDist *dist, const double q, double *err)
 {
-	StableArgsCdf *args = (StableArgsCdf *)ptr_args;
-	int counter_ = 0;
+	struct stable_config cfg;
+	struct _inv_state st;
+	struct _inv_chain ch;
+	double x, err_;
 
-	while (counter_ < args->Nx) {
-		args->cdf[counter_] = (*(args->ptr_funcion))(args->dist, args->x[counter_],
-							  &(args->err[counter_]));
-		counter_++;
-	}
+	// Casos particulares
+	if (_inv_exact(dist, q, &x))
+		return x;
 
-	pthread_exit(NULL);
+	if (err == NULL)
+		err = &err_;
+
+	stable_get_config(dist, &cfg);
+	st.valid = 0;
+	_inv_chain_init(&ch);
+
+	return _inv_solve(dist, &cfg, q, &st, &ch, err);
 }
 
-void stable_inv(StableDist *dist, const double q[], const int Nq,
-				double *inv, double *err)
+typedef struct {
+	StableDist *dist;
+	struct stable_config cfg;
+	const double *q;
+	const int *order;  // Quantiles sorted by q
+	int Nq;
+	double *inv;
+	double *err;
+	int next;
+} StableArgsInv;
+
+struct _inv_query {
+	double q;
+	int index;
+};
+
+/* Each thread solves the quantiles of a chunk in increasing order, each one
+   from what the previous solve left in the chain and in the solver state, so
+   the maximum of the integrand is not searched again. */
+void thread_init_inv(struct stable_worker *worker, void *ptr_args)
 {
-	int Nq_thread[THREADS],
-		initpoint[THREADS],
-		k, flag = 0;
-	void *status;
-	pthread_t threads[THREADS];
-	StableArgsCdf args[THREADS];
+	StableArgsInv *args = (StableArgsInv *)ptr_args;
+	struct _inv_state st;
+	struct _inv_chain ch;
+	int k, end, i;
 
-	/* If no error pointer is introduced, it's created*/
-	if (err == NULL) {
-		flag = 1;
-		err = malloc(Nq * sizeof(double));
+	while (stable_pool_take(worker, &args->next, args->Nq, &k, &end)) {
+		st.valid = 0;
+		_inv_chain_init(&ch);
+
+		for (; k < end; k++) {
+			i = args->order[k];
+
+			if (!_inv_exact(args->dist, args->q[i], &args->inv[i]))
+				args->inv[i] = _inv_solve(args->dist, &args->cfg, args->q[i], &st, &ch,
+										  &args->err[i]);
+		}
 	}
+}
 
-	/* Evaluation points divided among available threads */
-	/* Reparto de los puntos de evaluacion entre los hilos disponibles */
-	Nq_thread[0] = Nq / THREADS;
+/* NaN goes last, where it does not break the chain */
+static int _inv_compare_queries(const void *a, const void *b)
+{
+	double qa = ((const struct _inv_query *)a)->q, qb = ((const struct _inv_query *)b)->q;
 
-	if (0 < Nq % THREADS) Nq_thread[0]++;
+	if (isnan(qa) || isnan(qb))
+		return isnan(qa) - isnan(qb);
 
-	initpoint[0] = 0;
+	return (qa > qb) - (qa < qb);
+}
 
-	for (k = 1; k < THREADS; k++) {
-		Nq_thread[k] = Nq / THREADS;
+void stable_inv(StableDist *dist, const double q[], const int Nq,
+				double *inv, double *err)
+{
+	struct _inv_query *queries = NULL;
+	double *own_err = NULL;
+	int *order, k;
+	StableArgsInv args;
 
-		if (k < Nq % THREADS) Nq_thread[k]++;
+	/* If no error pointer is introduced, it's created*/
+	if (err == NULL)
+		err = own_err = malloc(Nq * sizeof(double));
 
-		initpoint[k] = initpoint[k - 1] + Nq_thread[k - 1];
-	}
+	order = malloc(Nq * sizeof(int));
 
-	/* Threads' creation. A copy of the ditribution is created for each of them*/
-	/* Creacion de los hilos, pasando a cada uno una copia de la distribucion */
-	for (k = 0; k < THREADS; k++) {
-		args[k].ptr_funcion = stable_inv_point;
+	if (err == NULL || order == NULL) {
+		for (k = 0; k < Nq; k++)
+			inv[k] = stable_inv_point(dist, q[k], NULL);
 
-		args[k].dist = stable_copy(dist);
-		args[k].cdf  = inv + initpoint[k];
-		args[k].x    = q + initpoint[k];
-		args[k].Nx   = Nq_thread[k];
-		args[k].err  = err + initpoint[k];
+		free(order);
+		free(own_err);
+		return;
+	}
 
-		if (pthread_create(&threads[k], NULL, thread_init_inv, (void *)&args[k])) {
-			perror("Error en la creacion de hilo");
+	for (k = 0; k < Nq; k++)
+		order[k] = k;
 
-			if (flag == 1) free(err);
+	/* Grids are usually given in order already */
+	for (k = 1; k < Nq && (q[k - 1] <= q[k] || isnan(q[k])); k++);
 
-			return;
+	if (k < Nq && (queries = malloc(Nq * sizeof(struct _inv_query))) != NULL) {
+		for (k = 0; k < Nq; k++) {
+			queries[k].q = q[k];
+			queries[k].index = k;
 		}
-	}
 
-	/* Wait until treadhs execution terminates */
-	/* Esperar a finalizacion de todos los hilos */
-	for (k = 0; k < THREADS; k++)
-		pthread_join(threads[k], &status);
+		qsort(queries, Nq, sizeof(struct _inv_query), _inv_compare_queries);
 
-	/* Free distribution copies */
-	/* Liberar las copias de la distribucion realizadas */
-	for (k = 0; k < THREADS; k++)
-		stable_free(args[k].dist);
+		for (k = 0; k < Nq; k++)
+			order[k] = queries[k].index;
+
+		free(queries);
+	}
 
-	if (flag == 1) free(err);
+	/* Chunks of consecutive quantiles taken by the pool threads, all of them
+	   reading the same distribution */
+	args.dist = dist;
+	args.q = q;
+	args.order = order;
+	args.Nq = Nq;
+	args.inv = inv;
+	args.err = err;
+	args.next = 0;
+
+	stable_get_config(dist, &args.cfg);
+	stable_pool_run(args.cfg.THREADS, thread_init_inv, &args);
+
+	free(order);
+	free(own_err);
 }
 
 short stable_inv_gpu(StableDist *dist, const double q[], const int Nq,
@@ -31,31 +31,33 @@
  */
 #include "stable_api.h"
 #include "stable_integration.h"
+#include "stable_kernels.h"
 
 #include "methods.h"
-#include <pthread.h>
+#include "stable_pool.h"
 
 double stable_pdf_g1(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, V, aux;
 
-	//  g   = dist->beta_;
-	//  aux = theta+dist->theta0_;
+	//  g   = ctx->beta_;
+	//  aux = theta+ctx->theta0_;
 	//  V   = M_PI_2-theta;
 
 	//  if ((g==1 && aux < THETA_TH*1.1) || (g==-1 && V<THETA_TH*1.1)) {
 	//    V = dist->Vbeta1;// printf("");
 	//  }
 	//  else {
-	aux = (dist->beta_ * theta + M_PI_2) / cos(theta);
-	V = sin(theta) * aux / dist->beta_ + log(aux) + dist->k1;
+	aux = (ctx->beta_ * theta + M_PI_2) / cos(theta);
+	V = sin(theta) * aux / ctx->beta_ + log(aux) + dist->k1;
 	//  }
 #ifdef DEBUG
 	integ_eval++;
 #endif
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 	//Obtenemos log(g), en realidad
 	//Taylor: exp(-x) ~ 1-x en x ~ 0
@@ -70,7 +72,7 @@ double stable_pdf_g1(double theta, void *args)
 	if (isnan(g) || g < 0) return 0.0;
 
 	/*fprintf(FINTEG,"%1.4f\t%1.4f\t%1.6f\t%1.6e\n",
-	        dist->alfa,dist->beta_,theta,g);*/
+	        dist->alfa,ctx->beta_,theta,g);*/
 
 	//  else return g;
 	return g;
@@ -78,11 +80,12 @@ double stable_pdf_g1(double theta, void *args)
 
 double stable_pdf_g2(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, cos_theta, aux, V;
 
-	//  g   = dist->beta_;
-	//  aux = theta+dist->theta0_;
+	//  g   = ctx->beta_;
+	//  aux = theta+ctx->theta0_;
 	//  V   = M_PI_2-theta;
 
 	//  if ((g==1 && aux < THETA_TH*1.1 && dist->alfa <1) || (g==-1 && V<THETA_TH*1.1 && dist->alfa>1)) {
@@ -91,7 +94,7 @@ double stable_pdf_g2(double theta, void *args)
 	//  else {
 
 	cos_theta = cos(theta);
-	aux = (dist->theta0_ + theta) * dist->alfa;
+	aux = (ctx->theta0_ + theta) * dist->alfa;
 	V = log(cos_theta / sin(aux)) * dist->alfainvalfa1 +
 		+ log(cos(aux - theta) / cos_theta) + dist->k1;
 	//  }
@@ -100,7 +103,7 @@ double stable_pdf_g2(double theta, void *args)
 	integ_eval++;
 #endif
 
-	g = V + dist->xxipow; // This g seems to be the same returned by stable_g_aux2.
+	g = V + ctx->xxipow; // This g seems to be the same returned by stable_g_aux2.
 
 
 	//g>6.55 -> exp(g-exp(g)) < 2.1E-301
@@ -119,7 +122,7 @@ double stable_pdf_g2(double theta, void *args)
 
 	/*
 	  fprintf(FINTEG,"%1.16lf\t%1.16lf\t%1.16lf\t%1.16e\n",
-	          dist->alfa,dist->beta_,theta,g);
+	          dist->alfa,ctx->beta_,theta,g);
 	*/
 
 	return g;
@@ -127,7 +130,8 @@ double stable_pdf_g2(double theta, void *args)
 
 double stable_pdf_g(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 
 	if (dist->ZONE == ALFA_1)
 		return stable_pdf_g1(theta, args);
@@ -139,12 +143,13 @@ double stable_pdf_g(double theta, void *args)
 
 double stable_g_aux1(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, V, aux;
 
-	aux = (dist->beta_ * theta + M_PI_2) / cos(theta);
-	V = sin(theta) * aux / dist->beta_ + log(aux) + dist->k1;
-	g = V + dist->xxipow;
+	aux = (ctx->beta_ * theta + M_PI_2) / cos(theta);
+	V = sin(theta) * aux / ctx->beta_ + log(aux) + dist->k1;
+	g = V + ctx->xxipow;
 
 	//  printf("%lf %lf %lf",theta,V,g); getchar();
 
@@ -159,15 +164,16 @@ double stable_g_aux1(double theta, void *args)
 
 double stable_g_aux2(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 	double g, cos_theta, aux, V;
 
 	cos_theta = cos(theta);
-	aux = (dist->theta0_ + theta) * dist->alfa;
+	aux = (ctx->theta0_ + theta) * dist->alfa;
 	V = log(cos_theta / sin(aux)) * dist->alfainvalfa1 +
 		+ log(cos(aux - theta) / cos_theta) + dist->k1;
 
-	g = V + dist->xxipow;
+	g = V + ctx->xxipow;
 
 #ifdef DEBUG
 	integ_eval++;
@@ -180,7 +186,8 @@ double stable_g_aux2(double theta, void *args)
 
 double stable_g_aux(double theta, void *args)
 {
-	StableDist *dist = (StableDist *)args;
+	StableEvalCtx *ctx = (StableEvalCtx *)args;
+	const StableDist *dist = ctx->dist;
 
 	if (dist->ZONE == ALFA_1)
 		return stable_g_aux1(theta, args);
@@ -188,79 +195,97 @@ double stable_g_aux(double theta, void *args)
 		return stable_g_aux2(theta, args);
 }
 
-void *thread_init_pdf(void *ptr_args)
+/* Node kernels (stable_kernels.h), same values as the scalar integrands */
+void stable_pdf_g1_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n)
 {
-	StableArgsPdf *args = (StableArgsPdf *)ptr_args;
-	int counter_ = 0;
+	const StableDist *dist = ctx->dist;
+	double aux, v;
+	int i;
 
-	while (counter_ < args->Nx) {
-		args->pdf[counter_] = (*(args->ptr_funcion))(args->dist, args->x[counter_],
-							  &(args->err[counter_]));
-		counter_++;
+	for (i = 0; i < n; i++) {
+		aux = (ctx->beta_ * theta[i] + M_PI_2) / stable_vm_cos(theta[i]);
+		v = stable_vm_sin(theta[i]) * aux / ctx->beta_ + stable_vm_log(aux) + dist->k1;
+		v = stable_vm_exp(v + ctx->xxipow);
+		v = v < 1.522e-8 ? (1.0 - v) * v : stable_vm_exp(-v) * v;
+		g[i] = v >= 0 ? v : 0.0;
 	}
 
-	pthread_exit(NULL);
+#ifdef DEBUG
+	integ_eval += n;
+#endif
 }
 
-void stable_pdf(StableDist *dist, const double x[], const int Nx,
-				double *pdf, double *err)
+void stable_g_aux2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n)
 {
-	int Nx_thread[THREADS],
-		initpoint[THREADS],
-		k, flag = 0;
-	void *status;
-	pthread_t threads[THREADS];
-	StableArgsPdf args[THREADS];
+	const StableDist *dist = ctx->dist;
+	double cos_theta, aux;
+	int i;
 
-	/* Si no se introduce el puntero para el error, se crea*/
-	if (err == NULL) {
-		flag = 1;
-		err = malloc(Nx * sizeof(double));
+	for (i = 0; i < n; i++) {
+		cos_theta = stable_vm_cos(theta[i]);
+		aux = (ctx->theta0_ + theta[i]) * dist->alfa;
+		g[i] = stable_vm_log(cos_theta / stable_vm_sin(aux)) * dist->alfainvalfa1 +
+			   stable_vm_log(stable_vm_cos(aux - theta[i]) / cos_theta) + dist->k1 +
+			   ctx->xxipow;
 	}
 
-	/* Reparto de los puntos de evaluacion entre los hilos disponibles */
-
-	Nx_thread[0] = Nx / THREADS;
-
-	if (0 < Nx % THREADS) Nx_thread[0]++;
-
-	initpoint[0] = 0;
+#ifdef DEBUG
+	integ_eval += n;
+#endif
+}
 
-	for (k = 1; k < THREADS; k++) {
-		Nx_thread[k] = Nx / THREADS;
+void stable_pdf_g2_nodes(StableEvalCtx *ctx, const double theta[], double g[], int n)
+{
+	double v;
+	int i;
 
-		if (k < Nx % THREADS) Nx_thread[k]++;
+	stable_g_aux2_nodes(ctx, theta, g, n);
 
-		initpoint[k] = initpoint[k - 1] + Nx_thread[k - 1];
+	//g>6.55 -> exp(g-exp(g)) < 2.1E-301. NaN are also left out here.
+	for (i = 0; i < n; i++) {
+		v = stable_vm_exp(g[i]);
+		v = stable_vm_exp(-v) * v;
+		g[i] = g[i] <= 6.55 && g[i] >= -700 && v >= 0 ? v : 0.0;
 	}
+}
 
-	/* Creacion de los hilos, pasando a cada uno una copia de la distribucion */
-
-	for (k = 0; k < THREADS; k++) {
-		args[k].ptr_funcion = dist->stable_pdf_point;
-
-		args[k].dist = stable_copy(dist);
-		args[k].pdf  = pdf + initpoint[k];
-		args[k].x    = x + initpoint[k];
-		args[k].Nx   = Nx_thread[k];
-		args[k].err  = err + initpoint[k];
+void thread_init_pdf(struct stable_worker *worker, void *ptr_args)
+{
+	StableArgsPdf *args = (StableArgsPdf *)ptr_args;
+	int counter_, end;
 
-		if (pthread_create(&threads[k], NULL, thread_init_pdf, (void *)&args[k])) {
-			perror("Error en la creacion de hilo");
+	while (stable_pool_take(worker, &args->next, args->Nx, &counter_, &end)) {
+		for (; counter_ < end; counter_++)
+			args->pdf[counter_] = (*(args->ptr_funcion))(args->dist, args->x[counter_],
+								  &(args->err[counter_]));
+	}
+}
 
-			if (flag == 1) free(err);
+void stable_pdf(StableDist *dist, const double x[], const int Nx,
+				double *pdf, double *err)
+{
+	int flag = 0;
+	struct stable_config cfg;
+	StableArgsPdf args;
 
-			return;
-		}
+	/* Si no se introduce el puntero para el error, se crea*/
+	if (err == NULL) {
+		flag = 1;
+		err = malloc(Nx * sizeof(double));
 	}
 
-	/* Esperar a finalizacion de todos los hilos */
-	for (k = 0; k < THREADS; k++)
-		pthread_join(threads[k], &status);
+	/* Los hilos del pool se reparten los puntos de evaluacion, que comparten la
+	   misma distribucion */
+	args.ptr_funcion = dist->stable_pdf_point;
+	args.dist = dist;
+	args.pdf  = pdf;
+	args.x    = x;
+	args.Nx   = Nx;
+	args.err  = err;
+	args.next = 0;
 
-	/* Liberar las copias de la distribucion realizadas */
-	for (k = 0; k < THREADS; k++)
-		stable_free(args[k].dist);
+	stable_get_config(dist, &cfg);
+	stable_pool_run(cfg.THREADS, thread_init_pdf, &args);
 
 	if (flag == 1) free(err);
 }
@@ -270,11 +295,12 @@ void stable_pdf(StableDist *dist, const double x[], const int Nx,
 /******************************************************************************/
 
 double
-stable_integration_pdf_low(StableDist *dist, double(*integrando)(double, void *),
+stable_integration_pdf_low(StableEvalCtx *ctx, double(*integrando)(double, void *),
 						   double(*integ_aux)(double, void *), double *err)
 /*esta es estrategia de baja precision: 2 intervalos de integracion:simetrico en
 torno al maximo y el resto*/
 {
+	const struct stable_config *cfg = &ctx->cfg;
 	int warnz[5], k;
 	double pdf = 0,
 		   pdf_aux = 0, pdf1 = 0, /*pdf2=0.0,pdf3=0.0,*/
@@ -286,10 +312,10 @@ torno al maximo y el resto*/
 	int aux_eval = 0;
 #endif
 
-	theta[0] = -dist->theta0_ + THETA_TH;
+	theta[0] = -ctx->theta0_ + cfg->THETA_TH;
 	warnz[0] = 0;
-	theta[4] = M_PI_2 - THETA_TH;
-	theta[2] = zbrent(integ_aux, (void *)dist, theta[0], theta[4],
+	theta[4] = M_PI_2 - cfg->THETA_TH;
+	theta[2] = zbrent(integ_aux, (void *)ctx, theta[0], theta[4],
 					  0.0, 1e-6 * (theta[4] - theta[0]), &k);
 
 	switch (k) {
@@ -310,9 +336,9 @@ torno al maximo y el resto*/
 
 		case -2: //Max en el borde izquierdo del intervalo
 			// puede pasar si beta=+-1 y alfa<1        //  .
-			pdf1 = (integrando)(theta[0], (void *)dist);
+			pdf1 = (integrando)(theta[0], (void *)ctx);
 
-			theta[2] = zbrent(integrando, (void *)dist, theta[0], theta[4],
+			theta[2] = zbrent(integrando, (void *)ctx, theta[0], theta[4],
 							  pdf1 * 1e-6, 1e-6 * (theta[4] - theta[0]), &warnz[2]);
 			break;
 
@@ -322,9 +348,9 @@ torno al maximo y el resto*/
 			theta[4] = theta[0];
 			theta[0] = theta[1];
 
-			pdf1 = (integrando)(theta[0], (void *)dist);
+			pdf1 = (integrando)(theta[0], (void *)ctx);
 
-			theta[2] = zbrent(integrando, (void *)dist, theta[4], theta[0],
+			theta[2] = zbrent(integrando, (void *)ctx, theta[4], theta[0],
 							  pdf1 * 1e-6, 1e-6 * (theta[0] - theta[4]), &warnz[2]);
 			break;
 
@@ -339,8 +365,8 @@ torno al maximo y el resto*/
 	integ_eval = 0;
 #endif
 
-	stable_integration(dist, integrando, theta[0], theta[2],
-					   absTOL, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[0], theta[2],
+					   cfg->absTOL, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux, STABLE_QAG2);
 	pdf = fabs(pdf_aux);
 	*err = err_aux * err_aux;
@@ -350,11 +376,11 @@ torno al maximo y el resto*/
 	integ_eval = 0;
 #endif
 	/*
-	  printf("%e %e\n",max(pdf*relTOL,absTOL)*0.5,relTOL);
+	  printf("%e %e\n",max(pdf*cfg->relTOL,cfg->absTOL)*0.5,cfg->relTOL);
 	  getchar();
 	*/
-	stable_integration(dist, integrando, theta[2], theta[4],
-					   max(pdf * relTOL, absTOL) * 0.5, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[2], theta[4],
+					   max(pdf * cfg->relTOL, cfg->absTOL) * 0.5, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux, STABLE_QAG2);
 	pdf += fabs(pdf_aux);
 	*err += err_aux * err_aux;
@@ -372,14 +398,14 @@ torno al maximo y el resto*/
 	fprintf(FINTEG, " %d %d %d %d %d %d\n",
 			warnz[0], warnz[1], warnz[2], integ_eval, aux_eval,
 			warnz[0] + warnz[1] + warnz[2] + integ_eval + aux_eval);
-	printf("abstols % 1.3e % 1.3e % 1.3e % 1.3e \n", absTOL, max(pdf1 * relTOL, absTOL) * 0.5, max((pdf2 + pdf1)*relTOL, absTOL) * 0.25, max((pdf3 + pdf2 + pdf1)*relTOL, absTOL) * 0.25);
+	printf("abstols % 1.3e % 1.3e % 1.3e % 1.3e \n", cfg->absTOL, max(pdf1 * cfg->relTOL, cfg->absTOL) * 0.5, max((pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25, max((pdf3 + pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25);
 #endif
 
 	return pdf;
 }
 
 double
-stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
+stable_integration_pdf(StableEvalCtx *ctx, double(*integrando)(double, void *),
 					   double(*integ_aux)(double, void *), double *err) /* WTF is integ_aux */
 {
 	/* Este caso se da en:
@@ -396,6 +422,7 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	     - 3 y 4 - Integra en los bordes por debajo del umbral
 	     - Suma todo */
 
+	const struct stable_config *cfg = &ctx->cfg;
 	int warnz[5], k;
 	double pdf = 0,
 		   pdf_aux = 0, pdf1 = 0, pdf2 = 0.0, pdf3 = 0.0,
@@ -407,33 +434,33 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	int aux_eval = 0;
 #endif
 
-	theta[0] = -dist->theta0_ + THETA_TH;
+	theta[0] = -ctx->theta0_ + cfg->THETA_TH;
 	warnz[0] = 0;
-	theta[4] = M_PI_2 - THETA_TH;
+	theta[4] = M_PI_2 - cfg->THETA_TH;
 
-	theta[2] = zbrent(integ_aux, (void *)dist, theta[0], theta[4],
+	theta[2] = zbrent(integ_aux, (void *)ctx, theta[0], theta[4],
 					  0.0, 1e-6 * (theta[4] - theta[0]), &k);
 
 	switch (k) {
 		case 0:   //Max en el interior del intervalo de integracion.
 			// Busca puntos donde integrando cae por debajo de umbral
-			pdf1 = (integ_aux)(theta[0], (void *)dist);
-			pdf2 = (integ_aux)(theta[4], (void *)dist);
+			pdf1 = (integ_aux)(theta[0], (void *)ctx);
+			pdf2 = (integ_aux)(theta[4], (void *)ctx);
 
-			if (fabs(AUX1) > fabs(pdf1)) {
+			if (fabs(ctx->aux1) > fabs(pdf1)) {
 				//  printf("1 %1.1lf ",x);
 				theta[1] = theta[0] + 1e-2 * (theta[2] - theta[0]);
 			} else {
-				theta[1] = zbrent(integ_aux, (void *)dist, theta[0], theta[2],
-								  AUX1, 1e-6 * (theta[2] - theta[0]), &warnz[1]);
+				theta[1] = zbrent(integ_aux, (void *)ctx, theta[0], theta[2],
+								  ctx->aux1, 1e-6 * (theta[2] - theta[0]), &warnz[1]);
 			}
 
-			if (fabs(AUX2) > fabs(pdf2)) {
+			if (fabs(ctx->aux2) > fabs(pdf2)) {
 				//  printf("2 %1.1lf ",x);
 				theta[3] = theta[4] - 1e-2 * (theta[4] - theta[2]);
 			} else {
-				theta[3] = zbrent(integ_aux, (void *)dist, theta[2], theta[4],
-								  AUX2, 1e-6 * (theta[4] - theta[2]), &warnz[3]);
+				theta[3] = zbrent(integ_aux, (void *)ctx, theta[2], theta[4],
+								  ctx->aux2, 1e-6 * (theta[4] - theta[2]), &warnz[3]);
 			}
 
 			// Crea intervalo simetrico entorno al maximo con el punto encontrado
@@ -455,14 +482,14 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 		case -2: //Max en el borde izquierdo del intervalo
 			// puede pasar si beta=+-1 y alfa<1        //  .
 			theta[1] = theta[0];
-			pdf1 = (integrando)(theta[1], (void *)dist);
+			pdf1 = (integrando)(theta[1], (void *)ctx);
 
-			theta[2] = zbrent(integrando, (void *)dist, theta[1], theta[4],
+			theta[2] = zbrent(integrando, (void *)ctx, theta[1], theta[4],
 							  pdf1 * 1e-6, 1e-6 * (theta[4] - theta[1]), &warnz[2]);
-			pdf1 = stable_pdf_g(theta[2], (void *)dist);
-			theta[3] = zbrent(integrando, (void *)dist, theta[2], theta[4],
+			pdf1 = stable_pdf_g(theta[2], (void *)ctx);
+			theta[3] = zbrent(integrando, (void *)ctx, theta[2], theta[4],
 							  pdf1 * 1e-6, 1e-6 * (theta[4] - theta[2]), &warnz[2]);
-			pdf1 = stable_pdf_g(theta[3], (void *)dist);
+			pdf1 = stable_pdf_g(theta[3], (void *)ctx);
 
 			break;
 
@@ -470,12 +497,12 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 			// puede pasar si beta=+-1 y alfa<1
 			theta[1] = theta[4];
 			theta[4] = theta[0];
-			pdf1 = (integrando)(theta[1], (void *)dist);
+			pdf1 = (integrando)(theta[1], (void *)ctx);
 
-			theta[2] = zbrent(integrando, (void *)dist, theta[4], theta[1],
+			theta[2] = zbrent(integrando, (void *)ctx, theta[4], theta[1],
 							  pdf1 * 1e-6, 1e-6 * (theta[1] - theta[4]), &warnz[2]);
-			pdf1 = stable_pdf_g(theta[2], (void *)dist);
-			theta[3] = zbrent(integrando, (void *)dist, theta[4], theta[2],
+			pdf1 = stable_pdf_g(theta[2], (void *)ctx);
+			theta[3] = zbrent(integrando, (void *)ctx, theta[4], theta[2],
 							  pdf1 * 1e-6, 1e-6 * (theta[2] - theta[4]), &warnz[3]);
 
 			theta[0] = theta[1];
@@ -496,8 +523,8 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	int i;
 
 	i = 0;
-	stable_integration(dist, integrando, theta[1], theta[2],
-					   absTOL, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[1], theta[2],
+					   cfg->absTOL, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux,
 					   integration_algorithms[i++]);
 	pdf1 = fabs(pdf_aux);
@@ -508,8 +535,8 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	integ_eval = 0;
 #endif
 
-	stable_integration(dist, integrando, theta[2], theta[3],
-					   max(pdf1 * relTOL, absTOL) * 0.25, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[2], theta[3],
+					   max(pdf1 * cfg->relTOL, cfg->absTOL) * 0.25, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux,
 					   integration_algorithms[i++]);
 	pdf2 = fabs(pdf_aux);
@@ -519,8 +546,8 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	integ_eval = 0;
 #endif
 
-	stable_integration(dist, integrando, theta[3], theta[4],
-					   max((pdf2 + pdf1)*relTOL, absTOL) * 0.25, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[3], theta[4],
+					   max((pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux,
 					   integration_algorithms[i++]);
 	pdf3 = fabs(pdf_aux);
@@ -530,8 +557,8 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	integ_eval = 0;
 #endif
 
-	stable_integration(dist, integrando, theta[0], theta[1],
-					   max((pdf3 + pdf2 + pdf1)*relTOL, absTOL) * 0.25, relTOL, IT_MAX,
+	stable_integration(ctx, integrando, theta[0], theta[1],
+					   max((pdf3 + pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25, cfg->relTOL, cfg->IT_MAX,
 					   &pdf_aux, &err_aux,
 					   integration_algorithms[i++]);
 	*err += err_aux * err_aux;
@@ -551,7 +578,7 @@ stable_integration_pdf(StableDist *dist, double(*integrando)(double, void *),
 	fprintf(FINTEG, " %d %d %d %d %d %d\n",
 			warnz[0], warnz[1], warnz[2], integ_eval, aux_eval,
 			warnz[0] + warnz[1] + warnz[2] + integ_eval + aux_eval);
-	printf("abstols % 1.3e % 1.3e % 1.3e % 1.3e \n", absTOL, max(pdf1 * relTOL, absTOL) * 0.5, max((pdf2 + pdf1)*relTOL, absTOL) * 0.25, max((pdf3 + pdf2 + pdf1)*relTOL, absTOL) * 0.25);
+	printf("abstols % 1.3e % 1.3e % 1.3e % 1.3e \n", cfg->absTOL, max(pdf1 * cfg->relTOL, cfg->absTOL) * 0.5, max((pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25, max((pdf3 + pdf2 + pdf1)*cfg->relTOL, cfg->absTOL) * 0.25);
 
 #endif
 
@@ -596,7 +623,7 @@ void stable_pcdf_gpu(StableDist *dist, const double x[], const int Nx,
 /******************************************************************************/
 
 double
-stable_pdf_point_GAUSS(StableDist *dist, const double x, double *err)
+stable_pdf_point_GAUSS(const StableDist *dist, const double x, double *err)
 {
 	double x_ = (x - dist->mu_0) / dist->sigma;
 	*err = 0.0;
@@ -605,7 +632,7 @@ stable_pdf_point_GAUSS(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_pdf_point_CAUCHY(StableDist *dist, const double x, double *err)
+stable_pdf_point_CAUCHY(const StableDist *dist, const double x, double *err)
 {
 	double x_ = (x - dist->mu_0) / dist->sigma;
 	*err = 0.0;
@@ -614,7 +641,7 @@ stable_pdf_point_CAUCHY(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_pdf_point_LEVY(StableDist *dist, const double x, double *err)
+stable_pdf_point_LEVY(const StableDist *dist, const double x, double *err)
 {
 	double xxi = (x - dist->mu_0) / dist->sigma - dist->xi;
 	*err = 0.0;
@@ -635,7 +662,7 @@ stable_pdf_point_LEVY(StableDist *dist, const double x, double *err)
 /******************************************************************************/
 
 double
-stable_pdf_point_PEQXXIP(StableDist *dist, const double x, double *err)
+stable_pdf_point_PEQXXIP(const StableDist *dist, const double x, double *err)
 {
 	/* Este caso se da en:
 	       x ~ xi  con alfa > 1
@@ -652,57 +679,82 @@ stable_pdf_point_PEQXXIP(StableDist *dist, const double x, double *err)
 }
 
 double
-stable_pdf_point_MEDXXIP(StableDist *dist, const double x, double *err)
+stable_pdf_point_MEDXXIP(const StableDist *dist, const double x, double *err)
 {
 	return 0.0;
 }
 
 double
-stable_pdf_point_ALFA_1(StableDist *dist, const double x, double *err)
+stable_pdf_point_ALFA_1(const StableDist *dist, const double x, double *err)
 {
 	double pdf = 0;
 	double x_;//, xxi;
+	StableEvalCtx ctx;
 
 #ifdef DEBUG
 	integ_eval = 0;
 #endif
 
+	stable_eval_ctx_init(&ctx, dist);
+
 	x_ = (x - dist->mu_0) / dist->sigma;
 	//xxi=x_-dist->xi;
-	dist->beta_ = dist->beta;
+
+	/* Far from xi the tail expansion replaces the integration, if precise.
+	   Its truncation error is returned relative to the PDF, as the error of
+	   the integration */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_TAILS) &&
+		stable_tail_series_point(&dist->tail[PDF][x_ < 0], fabs(x_),
+								 ctx.cfg.relTOL, &pdf, err)) {
+		*err = pdf > 0 ? *err / pdf : 0.0;
+		return pdf / dist->sigma;
+	}
+
+	ctx.beta_ = dist->beta;
 
 	if (dist->beta < 0.0) {
 		x_ = -x_;
-		dist->beta_ = -dist->beta;
+		ctx.beta_ = -dist->beta;
 	}
 
 	else
-		dist->beta_ = dist->beta;
+		ctx.beta_ = dist->beta;
 
-	dist->xxipow = (-M_PI * x_ * dist->c2_part);
+	ctx.xxipow = (-M_PI * x_ * dist->c2_part);
 
-	pdf = stable_integration_pdf(dist, &stable_pdf_g1, &stable_g_aux1, err);
+	pdf = stable_integration_pdf(&ctx, &stable_pdf_g1, &stable_g_aux1, err);
 	pdf = dist->c2_part * pdf;
 	return pdf / dist->sigma;
 }
 
-double stable_pdf_point_STABLE(StableDist *dist, const double x, double *err)
+double stable_pdf_point_STABLE(const StableDist *dist, const double x, double *err)
 {
 	double pdf = 0;
 	double x_, xxi;
+	StableEvalCtx ctx;
 
 #ifdef DEBUG
 	int aux_eval = 0;
 	integ_eval = 0;
 #endif
 
+	stable_eval_ctx_init(&ctx, dist);
+
 	x_ = (x - dist->mu_0) / dist->sigma;
 	xxi = x_ - dist->xi;
 
+	/* Near xi the power series replaces the integration, if precise */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_CENTER) &&
+		stable_center_series_point(&dist->center[PDF], xxi, ctx.cfg.relTOL,
+								   &pdf, err)) {
+		*err = pdf > 0 ? *err / pdf : 0.0;
+		return pdf / dist->sigma;
+	}
+
 	/*Si justo evaluo en o cerca de xi interpolacion lineal*/
 	//xxi_th = XXI_TH*(1.0+fabs(dist->alfainvalfa1-1.0));
 
-	if (fabs(xxi) <= XXI_TH) {
+	if (fabs(xxi) <= ctx.cfg.XXI_TH) {
 		*err = 0;
 		//      printf("_%lf_\n",x);
 		pdf = exp(gammaln(1.0 + 1.0 / dist->alfa)) *
@@ -727,20 +779,28 @@ double stable_pdf_point_STABLE(StableDist *dist, const double x, double *err)
 
 	/* No tenemos la suerte de x ~ ξ, toca usar la otra expresión. */
 
+	/* Far from xi the tail expansion replaces the integration, if precise */
+	if ((ctx.cfg.EVAL_MODE & STABLE_EVAL_TAILS) &&
+		stable_tail_series_point(&dist->tail[PDF][xxi < 0], fabs(xxi),
+								 ctx.cfg.relTOL, &pdf, err)) {
+		*err = pdf > 0 ? *err / pdf : 0.0;
+		return pdf / dist->sigma;
+	}
+
 	if (xxi < 0) { /* pdf(x<xi,a,b) = pdf(-x,a,-b)*/
 		xxi = -xxi;
-		dist->theta0_ = -dist->theta0; /*theta0(a,-b)=-theta0(a,b)*/
-		dist->beta_ = -dist->beta;
+		ctx.theta0_ = -dist->theta0; /*theta0(a,-b)=-theta0(a,b)*/
+		ctx.beta_ = -dist->beta;
 	} else {
-		dist->theta0_ = dist->theta0;
-		dist->beta_ = dist->beta;
+		ctx.theta0_ = dist->theta0;
+		ctx.beta_ = dist->beta;
 	}
 
-	dist->xxipow = dist->alfainvalfa1 * log(fabs(xxi));
+	ctx.xxipow = dist->alfainvalfa1 * log(fabs(xxi));
 
 	/*Si theta0~=-PI/2 intervalo de integración nulo*/
 	/*incluye a beta=+-1 y alfa<1->pdf nula a la izqda/dcha de xi*/
-	if (fabs(dist->theta0_ + M_PI_2) < 2 * THETA_TH) {
+	if (fabs(ctx.theta0_ + M_PI_2) < 2 * ctx.cfg.THETA_TH) {
 #ifdef DEBUG
 		printf("Intervalo de integracion nulo\n");
 #endif
@@ -748,11 +808,11 @@ double stable_pdf_point_STABLE(StableDist *dist, const double x, double *err)
 		return 0.0;
 	}
 
-	//  if (dist->xxipow > XXIPOWMAX)
+	//  if (ctx.xxipow > XXIPOWMAX)
 	//    {
-	pdf = stable_integration_pdf(dist, &stable_pdf_g2, &stable_g_aux2, err);
+	pdf = stable_integration_pdf(&ctx, &stable_pdf_g2, &stable_g_aux2, err);
 	//    }
-	//  else if (dist->xxipow < XXIPOWMIN)
+	//  else if (ctx.xxipow < XXIPOWMIN)
 	//    {
 	//      pdf = stable_pdf_point_PEQXXIP(dist,x,err)
 	//    }
@@ -771,7 +831,7 @@ double stable_pdf_point_STABLE(StableDist *dist, const double x, double *err)
 /*   PDF point en general                                                     */
 /******************************************************************************/
 
-double stable_pdf_point(StableDist *dist, const double x, double *err)
+double stable_pdf_point(const StableDist *dist, const double x, double *err)
 {
 	double temp;
 
@@ -779,3 +839,242 @@ double stable_pdf_point(StableDist *dist, const double x, double *err)
 
 	return (dist->stable_pdf_point)(dist, x, err);
 }
+
+/******************************************************************************/
+/*   Derivadas de la PDF respecto de los parametros                           */
+/******************************************************************************/
+
+#define STABLE_GRAD_STEP 1e-3  // Relative step of the differences of the fallback
+
+/* PDF of the standard distribution at x_ and derivatives of its logarithm with
+   respect to alfa, beta (at fixed x_) and x_, from one integration. Returns 0,
+   with nothing computed, where that integral is not used: zones other than
+   STABLE, x_ close to xi and the side of xi out of the support. */
+static short _pdf_grad_std(const StableDist *dist, double x_, double *pdf, double dlog[3])
+{
+	StableEvalCtx ctx;
+	double alfa = dist->alfa, A = dist->alfainvalfa1, xxi, lx, sign, tan_a, q;
+	double xi_a, xi_b, th_a, th_b, k1_a, k1_b, A_a, W, dv[2][4], theta[5], r[4], abserr[4];
+	int n_theta;
+
+	if (dist->ZONE != STABLE)
+		return 0;
+
+	stable_eval_ctx_init(&ctx, dist);
+	xxi = x_ - dist->xi;
+
+	if (fabs(xxi) <= ctx.cfg.XXI_TH)
+		return 0;
+
+	sign = xxi < 0 ? -1.0 : 1.0;
+	ctx.theta0_ = sign * dist->theta0;
+	ctx.beta_ = sign * dist->beta;
+
+	if (fabs(ctx.theta0_ + M_PI_2) < 2 * ctx.cfg.THETA_TH)
+		return 0;
+
+	lx = log(fabs(xxi));
+	ctx.xxipow = A * lx;
+
+	/* Derivatives of xi = -beta tan(pi alfa / 2), theta0 = atan(-xi) / alfa,
+	   k1 = -log(1 + xi^2) / (2 (alfa - 1)) and A = alfa / (alfa - 1) */
+	tan_a = tan(0.5 * M_PI * alfa);
+	q = 1.0 + dist->xi * dist->xi;
+	xi_a = -dist->beta * M_PI_2 * (1.0 + tan_a * tan_a);
+	xi_b = -tan_a;
+	th_a = -xi_a / (alfa * q) - dist->theta0 / alfa;
+	th_b = -xi_b / (alfa * q);
+	k1_a = 0.5 * log(q) / ((alfa - 1.0) * (alfa - 1.0)) - dist->xi * xi_a / ((alfa - 1.0) * q);
+	k1_b = -dist->xi * xi_b / ((alfa - 1.0) * q);
+	A_a = -1.0 / ((alfa - 1.0) * (alfa - 1.0));
+
+	/* d log(V) / dp, with theta0_ = sign theta0 */
+	dv[0][0] = A_a;
+	dv[0][1] = 1.0;
+	dv[0][2] = alfa * sign * th_a;
+	dv[0][3] = k1_a;
+	dv[1][0] = 0.0;
+	dv[1][1] = 0.0;
+	dv[1][2] = alfa * sign * th_b;
+	dv[1][3] = k1_b;
+
+	n_theta = stable_integration_peak(&ctx, &stable_g_aux2, theta);
+	stable_integration_pdf_grad(&ctx, dv, theta, n_theta, 0.0, ctx.cfg.relTOL,
+								ctx.cfg.IT_MAX, r, abserr);
+
+	if (!(r[0] > 0))
+		return 0;
+
+	/* pdf = |A| / (pi |xxi|) I, and the xxipow part of dg/dp, the same on all
+	   nodes, is dA/dp log|xxi| + A d log|xxi| / dp, with
+	   d log|xxi| / dp = -(dxi / dp) / xxi. W is the integral of
+	   (e^g - e^2g) exp(-e^g) relative to I */
+	*pdf = dist->c2_part / fabs(xxi) * r[0];
+	W = (r[0] - r[1]) / r[0];
+
+	dlog[0] = -1.0 / (alfa * (alfa - 1.0)) + xi_a / xxi + (A_a * lx - A * xi_a / xxi) * W + r[2] / r[0];
+	dlog[1] = xi_b / xxi - A * xi_b / xxi * W + r[3] / r[0];
+	dlog[2] = (A * W - 1.0) / xxi;
+
+	return 1;
+}
+
+typedef struct {
+	StableDist *dist;
+	const double *x;
+	int Nx;
+	double *pdf;
+	double *grad;
+	int next;
+} StableArgsPdfGrad;
+
+void thread_init_pdf_grad(struct stable_worker *worker, void *ptr_args)
+{
+	StableArgsPdfGrad *args = (StableArgsPdfGrad *)ptr_args;
+	const StableDist *dist = args->dist;
+	double x_, pdf, dlog[3], *grad;
+	int k, end;
+
+	while (stable_pool_take(worker, &args->next, args->Nx, &k, &end)) {
+		for (; k < end; k++) {
+			grad = args->grad + 4 * k;
+			x_ = (args->x[k] - dist->mu_0) / dist->sigma;
+
+			/* Left for the differences where the integral is not used */
+			if (!_pdf_grad_std(dist, x_, &pdf, dlog)) {
+				grad[0] = NAN;
+				continue;
+			}
+
+			pdf /= dist->sigma;
+			args->pdf[k] = pdf;
+			grad[0] = pdf * dlog[0];
+			grad[1] = pdf * dlog[1];
+			grad[2] = -pdf * (1.0 + x_ * dlog[2]) / dist->sigma;
+			grad[3] = -pdf * dlog[2] / dist->sigma;
+		}
+	}
+}
+
+/* Central differences of the PDF (one sided at the ends of the parameter
+   space) at the n points x that the integral did not solve */
+static short _pdf_grad_diff(StableDist *dist, const double x[], int n, double *pdf,
+							double *grad)
+{
+	const double hi[2] = { 2.0, 1.0 };
+	double p[2], a, b, h, *xs, *f[2];
+	StableDist *near;
+	int k, i, j;
+	short error = -1;
+
+	xs = malloc(2 * n * sizeof(double));
+	f[0] = malloc(2 * n * sizeof(double));
+	near = stable_copy(dist);
+
+	if (xs == NULL || f[0] == NULL || near == NULL)
+		goto cleanup;
+
+	f[1] = f[0] + n;
+
+	stable_pdf(dist, x, n, pdf, NULL);
+
+	for (k = 0; k < 2; k++) {
+		p[0] = dist->alfa;
+		p[1] = dist->beta;
+		a = p[k] - STABLE_GRAD_STEP;
+		a = (k == 0 ? a > 0.0 : a >= -1.0) ? a : p[k];
+		b = p[k] + STABLE_GRAD_STEP <= hi[k] ? p[k] + STABLE_GRAD_STEP : p[k];
+
+		for (j = 0; j < 2; j++) {
+			p[k] = j == 0 ? a : b;
+
+			if (stable_setparams(near, p[0], p[1], dist->sigma, dist->mu_0, 0) < 0)
+				goto cleanup;
+
+			stable_pdf(near, x, n, f[j], NULL);
+		}
+
+		for (i = 0; i < n; i++)
+			grad[4 * i + k] = (f[1][i] - f[0][i]) / (b - a);
+	}
+
+	/* dpdf/dx, for the derivatives with respect to sigma and mu */
+	for (i = 0; i < n; i++) {
+		h = STABLE_GRAD_STEP * max(dist->sigma, fabs(x[i] - dist->mu_0));
+		xs[i] = x[i] - h;
+		xs[n + i] = x[i] + h;
+	}
+
+	stable_pdf(dist, xs, 2 * n, f[0], NULL);
+
+	for (i = 0; i < n; i++) {
+		h = xs[n + i] - xs[i];
+		a = (f[1][i] - f[0][i]) / h;
+		grad[4 * i + 2] = -(pdf[i] + (x[i] - dist->mu_0) * a) / dist->sigma;
+		grad[4 * i + 3] = -a;
+	}
+
+	error = 0;
+
+cleanup:
+	free(xs);
+	free(f[0]);
+	stable_free(near);
+
+	return error;
+}
+
+void stable_pdf_grad(StableDist *dist, const double x[], const int Nx,
+					 double *pdf, double *grad)
+{
+	struct stable_config cfg;
+	StableArgsPdfGrad args;
+	double *xd, *pdfd, *gradd;
+	int k, n;
+
+	args.dist = dist;
+	args.x = x;
+	args.Nx = Nx;
+	args.pdf = pdf;
+	args.grad = grad;
+	args.next = 0;
+
+	stable_get_config(dist, &cfg);
+	stable_pool_run(cfg.THREADS, thread_init_pdf_grad, &args);
+
+	for (k = 0, n = 0; k < Nx; k++)
+		n += isnan(grad[4 * k]);
+
+	if (n == 0)
+		return;
+
+	/* The rest, together */
+	xd = malloc(n * sizeof(double));
+	pdfd = malloc(n * sizeof(double));
+	gradd = malloc(4 * n * sizeof(double));
+
+	for (k = 0, n = 0; xd != NULL && k < Nx; k++)
+		if (isnan(grad[4 * k]))
+			xd[n++] = x[k];
+
+	if (xd == NULL || pdfd == NULL || gradd == NULL ||
+		_pdf_grad_diff(dist, xd, n, pdfd, gradd) != 0) {
+		perror("Error en el calculo de las derivadas de la PDF");
+
+		for (k = 0; k < Nx; k++)
+			if (isnan(grad[4 * k]))
+				pdf[k] = grad[4 * k + 1] = grad[4 * k + 2] = grad[4 * k + 3] = NAN;
+	} else {
+		for (k = 0, n = 0; k < Nx; k++) {
+			if (isnan(grad[4 * k])) {
+				pdf[k] = pdfd[n];
+				memcpy(grad + 4 * k, gradd + 4 * n, 4 * sizeof(double));
+				n++;
+			}
+		}
+	}
+
+	free(xd);
+	free(pdfd);
+	free(gradd);
+}
@@ -0,0 +1,257 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stable_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+
+static struct stable_pool *_pool = NULL;
+
+// Serializes batch calls made from different user threads.
+static pthread_mutex_t _pool_dispatch = PTHREAD_MUTEX_INITIALIZER;
+
+// Set in the worker threads, so nested batch calls made from inside a job
+// run inline instead of waiting on the pool they are running on.
+static pthread_key_t _worker_key;
+static pthread_once_t _worker_key_once = PTHREAD_ONCE_INIT;
+
+static void _stable_pool_make_key()
+{
+	pthread_key_create(&_worker_key, NULL);
+}
+
+static void *_stable_pool_worker(void *ptr_args)
+{
+	struct stable_worker *worker = (struct stable_worker *) ptr_args;
+	struct stable_pool *pool = worker->pool;
+	unsigned long seen = 0;
+	unsigned int active;
+
+	pthread_setspecific(_worker_key, worker);
+
+	pthread_mutex_lock(&pool->lock);
+
+	while (1) {
+		while (!pool->shutdown && pool->generation == seen)
+			pthread_cond_wait(&pool->job_ready, &pool->lock);
+
+		if (pool->shutdown)
+			break;
+
+		seen = pool->generation;
+		active = pool->active;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (worker->index < active) {
+			worker->count = active;
+			pool->job(worker, pool->args);
+		}
+
+		pthread_mutex_lock(&pool->lock);
+
+		if (--pool->pending == 0)
+			pthread_cond_signal(&pool->job_done);
+	}
+
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+static void _stable_pool_destroy(struct stable_pool *pool)
+{
+	unsigned int k;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->job_ready);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (k = 0; k < pool->size; k++)
+		pthread_join(pool->workers[k].thread, NULL);
+
+	pthread_cond_destroy(&pool->job_ready);
+	pthread_cond_destroy(&pool->job_done);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->workers);
+	free(pool);
+}
+
+static struct stable_pool *_stable_pool_create(unsigned int size)
+{
+	struct stable_pool *pool;
+	unsigned int k;
+
+	pool = calloc(1, sizeof(struct stable_pool));
+
+	if (pool == NULL)
+		return NULL;
+
+	pool->workers = calloc(size, sizeof(struct stable_worker));
+
+	if (pool->workers == NULL) {
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->job_ready, NULL);
+	pthread_cond_init(&pool->job_done, NULL);
+
+	for (k = 0; k < size; k++) {
+		pool->workers[k].index = k;
+		pool->workers[k].count = size;
+		pool->workers[k].pool = pool;
+
+		if (pthread_create(&pool->workers[k].thread, NULL,
+						   _stable_pool_worker, &pool->workers[k])) {
+			perror("Error en la creacion de hilo");
+			_stable_pool_destroy(pool);
+			return NULL;
+		}
+
+		pool->size = k + 1;
+	}
+
+	return pool;
+}
+
+static void _stable_pool_run_inline(stable_pool_job job, void *args)
+{
+	struct stable_worker worker;
+
+	worker.index = 0;
+	worker.count = 1;
+	worker.pool = NULL;
+
+	job(&worker, args);
+}
+
+void stable_pool_run(unsigned int threads, stable_pool_job job, void *args)
+{
+	struct stable_pool *pool;
+
+	if (threads == 0 || threads > THREADS)
+		threads = THREADS;
+
+	pthread_once(&_worker_key_once, _stable_pool_make_key);
+
+	/* Nothing to share with a single thread, and nested calls from a worker
+	   must not wait on the pool they are running on. */
+	if (threads <= 1 || pthread_getspecific(_worker_key) != NULL) {
+		_stable_pool_run_inline(job, args);
+		return;
+	}
+
+	pthread_mutex_lock(&_pool_dispatch);
+
+	if (_pool == NULL)
+		_pool = _stable_pool_create(THREADS);
+
+	if ((pool = _pool) == NULL) {
+		pthread_mutex_unlock(&_pool_dispatch);
+		_stable_pool_run_inline(job, args);
+		return;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->job = job;
+	pool->args = args;
+	pool->active = threads < pool->size ? threads : pool->size;
+	pool->pending = pool->size;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->job_ready);
+
+	while (pool->pending > 0)
+		pthread_cond_wait(&pool->job_done, &pool->lock);
+
+	pthread_mutex_unlock(&pool->lock);
+
+	pthread_mutex_unlock(&_pool_dispatch);
+}
+
+unsigned int stable_pool_grain(const struct stable_worker *worker, const int N)
+{
+	unsigned int grain;
+
+	if (worker->count <= 1)
+		return N > 0 ? N : 1;
+
+	/* Every worker adds one last chunk to the counter after the N points have
+	   been taken, which must not overflow it */
+	if (CHUNK_SIZE > 0)
+		return max(1, min(CHUNK_SIZE, (unsigned int)(INT_MAX - N) / worker->count));
+
+	/* Around eight chunks per thread, so threads that got cheap points can
+	   take over the remaining work, but never so small that the counter
+	   becomes contended or so large that a single chunk makes a straggler. */
+	grain = N / (8 * worker->count);
+
+	return max(1, min(grain, STABLE_POOL_MAX_GRAIN));
+}
+
+int stable_pool_take(const struct stable_worker *worker, int *next,
+					 const int N, int *begin, int *end)
+{
+	int grain = stable_pool_grain(worker, N);
+
+	*begin = __sync_fetch_and_add(next, grain);
+
+	if (*begin >= N)
+		return 0;
+
+	*end = min(*begin + grain, N);
+
+	return 1;
+}
+
+void stable_pool_resize()
+{
+	pthread_once(&_worker_key_once, _stable_pool_make_key);
+
+	// A worker can not tear down the pool it is running on.
+	if (pthread_getspecific(_worker_key) != NULL)
+		return;
+
+	pthread_mutex_lock(&_pool_dispatch);
+
+	if (_pool != NULL && _pool->size != THREADS) {
+		_stable_pool_destroy(_pool);
+		_pool = NULL;
+	}
+
+	pthread_mutex_unlock(&_pool_dispatch);
+}
+
+void stable_pool_free()
+{
+	pthread_once(&_worker_key_once, _stable_pool_make_key);
+
+	if (pthread_getspecific(_worker_key) != NULL)
+		return;
+
+	pthread_mutex_lock(&_pool_dispatch);
+
+	if (_pool != NULL) {
+		_stable_pool_destroy(_pool);
+		_pool = NULL;
+	}
+
+	pthread_mutex_unlock(&_pool_dispatch);
+}
@@ -27,36 +27,642 @@
  *  jroyval@lpi.tel.uva.es
  */
 #include "stable_api.h"
+#include "stable_kernels.h"
+#include "stable_pool.h"
+#include "stable_table.h"
 #include "opencl_integ.h"
-#include <gsl/gsl_randist.h>
+
+/*
+ * Variates are drawn from a counter-based generator, Philox4x32-10 (Salmon et
+ * al., "Parallel random numbers: as easy as 1, 2, 3", SC'11): variate i of
+ * stream s is the Chambers-Mallows-Stuck transform of the two uniforms of
+ * 53 bits made from Philox(key, {i, s}), with the key set by stable_rnd_seed.
+ * Any variate is obtained without generating the previous ones, so the output
+ * does not depend on the number of threads or on how the blocks are shared,
+ * and any range of a stream can be regenerated on its own.
+ *
+ * stable_rnd splits the output in blocks of STABLE_RND_BLOCK variates that
+ * the threads of the pool take as they do with the points of stable_pdf. The
+ * uniforms of a block are generated first and transformed then all at once
+ * with the branch-free functions of stable_kernels.h, so both loops are
+ * vectorized.
+ *
+ * An iterator (stable_rnd_iter) reads a stream without bounds through a ring
+ * of slots, each holding a block of consecutive variates. Its own threads
+ * generate the blocks ahead of the reader into the free slots, and a slot is
+ * freed when the reader moves on to the next block. Block k is always made of
+ * the same variates, so the iterator reads the same numbers as stable_rnd.
+ */
+#define STABLE_RND_BLOCK 1024
+#define STABLE_RND_ITER_BLOCK (16 * STABLE_RND_BLOCK)  // Default variates per slot
+
+struct _rnd_args {
+	const StableDist *dist;
+	double *rnd;
+	unsigned int n;
+	uint64_t stream;
+	uint64_t first;
+	const struct _rnd_qmc *qmc;  // Sobol points, or NULL for Philox
+	int blocks;
+	int next;  // First block not yet taken by any thread
+};
 
 void
 stable_rnd_seed(StableDist * dist, unsigned long int s)
 {
 	gsl_rng_set(dist->gslrand, s);
+
+	dist->rnd_key = s;
+	dist->rnd_stream = 0;
+	dist->rnd_index = 0;
 }
 
+void stable_rnd_seek(StableDist *dist, uint64_t stream, uint64_t index)
+{
+	dist->rnd_stream = stream;
+	dist->rnd_index = index;
+}
 
-inline double
-stable_rnd_point(StableDist *dist)
+/* Philox4x32-10 block of the counter c with the key, in place */
+static inline void _rnd_philox_block(uint32_t c[4], uint64_t key)
 {
-	return dist->mu_1 +
-		   gsl_ran_levy_skew(dist->gslrand, dist->sigma, dist->alfa, dist->beta);
+	uint32_t k0 = (uint32_t)key, k1 = (uint32_t)(key >> 32), c0 = c[0], c1 = c[1], c2 = c[2], c3 = c[3];
+	uint64_t p0, p1;
+	int r;
+
+	for (r = 0; r < 10; r++) {
+		p0 = (uint64_t)0xD2511F53 * c0;
+		p1 = (uint64_t)0xCD9E8D57 * c2;
+		c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+		c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+		c1 = (uint32_t)p1;
+		c3 = (uint32_t)p0;
+		k0 += 0x9E3779B9;
+		k1 += 0xBB67AE85;
+	}
+
+	c[0] = c0;
+	c[1] = c1;
+	c[2] = c2;
+	c[3] = c3;
 }
 
-void
-stable_rnd(StableDist *dist, double *rnd, const unsigned int n)
+/* Uniform in (0, 1) from the 53 upper bits of x */
+static inline double _rnd_uniform(uint64_t x)
+{
+	return (double)((x >> 11) + 0.5) * 0x1p-53;
+}
+
+/* Uniforms u and w in (0, 1) of variates first, ..., first + n - 1 of the
+   stream, one Philox4x32-10 block each */
+static void _rnd_philox(uint64_t key, uint64_t stream, uint64_t first,
+						double u[], double w[], int n)
+{
+	uint32_t c[4];
+	uint64_t i;
+	int j;
+
+	for (j = 0; j < n; j++) {
+		i = first + j;
+		c[0] = (uint32_t)i;
+		c[1] = (uint32_t)(i >> 32);
+		c[2] = (uint32_t)stream;
+		c[3] = (uint32_t)(stream >> 32);
+
+		_rnd_philox_block(c, key);
+
+		u[j] = _rnd_uniform((uint64_t)c[1] << 32 | c[0]);
+		w[j] = _rnd_uniform((uint64_t)c[3] << 32 | c[2]);
+	}
+}
+
+/*
+ * Quasi-random uniforms of stable_rnd_qmc: point i of the two dimensional
+ * Sobol sequence, x(i) = XOR of the direction numbers v_k of the bits k set
+ * in i. The first dimension is the van der Corput sequence in base 2, and the
+ * second one has the primitive polynomial x + 1, v_k = v_(k-1) XOR v_(k-1)/2.
+ *
+ * Scrambling (STABLE_QMC_SCRAMBLE) multiplies the direction numbers by a
+ * random lower triangular binary matrix and XORs the points with a random
+ * digital shift (Matousek's linear scrambling), both drawn from Philox with
+ * the key and stream of the distribution. The points keep the low discrepancy
+ * of the sequence, and the mean over each stream is an unbiased estimate, so
+ * independent streams give the error of the estimate.
+ */
+struct _rnd_qmc {
+	uint64_t dir[2][64];  // Direction numbers of bit k of the index
+	uint64_t shift[2];
+	short inv;            // Only the first dimension, for stable_inv
+};
+
+/* Random bits j of the stream, from counters not taken by the variates */
+static uint64_t _rnd_bits(uint64_t key, uint64_t stream, uint64_t j)
+{
+	uint32_t c[4];
+
+	j = UINT64_MAX - j;
+	c[0] = (uint32_t)j;
+	c[1] = (uint32_t)(j >> 32);
+	c[2] = (uint32_t)stream;
+	c[3] = (uint32_t)(stream >> 32);
+
+	_rnd_philox_block(c, key);
+
+	return (uint64_t)c[1] << 32 | c[0];
+}
+
+static uint64_t _rnd_parity(uint64_t x)
+{
+	x ^= x >> 32;
+	x ^= x >> 16;
+	x ^= x >> 8;
+	x ^= x >> 4;
+	x ^= x >> 2;
+	x ^= x >> 1;
+
+	return x & 1;
+}
+
+static void _rnd_qmc_init(struct _rnd_qmc *qmc, const StableDist *dist, int mode)
+{
+	uint64_t rows[64], v, above;
+	int d, k, p;
+
+	for (k = 0; k < 64; k++) {
+		qmc->dir[0][k] = 1ULL << (63 - k);
+		qmc->dir[1][k] = k == 0 ? 1ULL << 63 : qmc->dir[1][k - 1] ^ (qmc->dir[1][k - 1] >> 1);
+	}
+
+	qmc->shift[0] = qmc->shift[1] = 0;
+	qmc->inv = mode & STABLE_QMC_INV ? 1 : 0;
+
+	if (!(mode & STABLE_QMC_SCRAMBLE))
+		return;
+
+	for (d = 0; d < 2; d++) {
+		/* Row p gives output bit p from input bit p and the more significant ones */
+		for (p = 0; p < 64; p++) {
+			above = p == 63 ? 0 : ~0ULL << (p + 1);
+			rows[p] = (_rnd_bits(dist->rnd_key, dist->rnd_stream, 65 * d + p) & above) | 1ULL << p;
+		}
+
+		for (k = 0; k < 64; k++) {
+			for (p = 0, v = 0; p < 64; p++)
+				v |= _rnd_parity(rows[p] & qmc->dir[d][k]) << p;
+
+			qmc->dir[d][k] = v;
+		}
+
+		qmc->shift[d] = _rnd_bits(dist->rnd_key, dist->rnd_stream, 65 * d + 64);
+	}
+}
+
+/* Uniforms u (and w, if not NULL) in (0, 1) of points first, ..., first + n - 1 */
+static void _rnd_sobol(const struct _rnd_qmc *qmc, uint64_t first, double u[],
+					   double w[], int n)
 {
-	//double *rnd;
+	uint64_t i, x, y, m, last = first + n - 1;
+	int j, k, bits;
+
+	/* Bits of the indexes of the block */
+	for (bits = 0; bits < 64 && last >> bits; bits++);
+
+	for (j = 0; j < n; j++) {
+		i = first + j;
+		x = qmc->shift[0];
+		y = qmc->shift[1];
+
+		for (k = 0; k < bits; k++) {
+			m = -((i >> k) & 1);
+			x ^= qmc->dir[0][k] & m;
+			y ^= qmc->dir[1][k] & m;
+		}
+
+		u[j] = _rnd_uniform(x);
+
+		if (w != NULL)
+			w[j] = _rnd_uniform(y);
+	}
+}
+
+/*
+ * Variates from the uniforms u and w in (0, 1) of each index, selected with
+ * the ZONE of the distribution by stable_setparams as the PDF is. The general
+ * ones are the Chambers-Mallows-Stuck method of gsl_ran_levy_skew, from the
+ * angle V = pi (u - 1/2) and the exponential W = -log(w); the particular
+ * cases use cheaper transforms of the same uniforms:
+ *
+ *   GAUSS:     X = 2 sqrt(W) cos(2V), Box-Muller with variance 2.
+ *   CAUCHY:    X = tan(V).
+ *   LEVY:      X = beta / Z^2 with Z^2 = 2W cos^2(2V), Z ~ N(0, 1).
+ *   beta = 0:  the CMS method without the skewness terms B and S.
+ */
+void stable_rnd_transform_STABLE(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n)
+{
+	const double alfa = dist->alfa, beta = dist->beta, c = dist->sigma;
+	const double shift = dist->mu_1;
+	const double t = beta * tan(M_PI_2 * alfa), B = atan(t) / alfa;
+	const double S = pow(1 + t * t, 1 / (2 * alfa)), ia = 1 / alfa, p = (1 - alfa) / alfa;
+	double V, W, X;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		V = M_PI * (u[i] - 0.5);
+		W = -stable_vm_log(w[i]);
+		X = S * stable_vm_sin(alfa * (V + B)) *
+			stable_vm_exp(p * stable_vm_log(stable_vm_cos(V - alfa * (V + B)) / W)
+						  - ia * stable_vm_log(stable_vm_cos(V)));
+		rnd[i] = shift + c * X;
+	}
+}
+
+void stable_rnd_transform_SYMMETRIC(const StableDist *dist, const double u[],
+									const double w[], double rnd[], int n)
+{
+	const double alfa = dist->alfa, c = dist->sigma, shift = dist->mu_1;
+	const double ia = 1 / alfa, p = (1 - alfa) / alfa;
+	double V, W, X;
 	int i;
 
-	//rnd = (double*)malloc(n*sizeof(double));
-	if (rnd == NULL) exit(2);
+	for (i = 0; i < n; i++) {
+		V = M_PI * (u[i] - 0.5);
+		W = -stable_vm_log(w[i]);
+		X = stable_vm_sin(alfa * V) *
+			stable_vm_exp(p * stable_vm_log(stable_vm_cos((1 - alfa) * V) / W)
+						  - ia * stable_vm_log(stable_vm_cos(V)));
+		rnd[i] = shift + c * X;
+	}
+}
+
+void stable_rnd_transform_ALFA_1(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n)
+{
+	const double beta = dist->beta, c = dist->sigma;
+	const double shift = dist->mu_1 + c * beta * log(c) / M_PI_2;
+	double V, W, X, cosV;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		V = M_PI * (u[i] - 0.5);
+		W = -stable_vm_log(w[i]);
+		cosV = stable_vm_cos(V);
+		X = (M_PI_2 + beta * V) * stable_vm_sin(V) / cosV -
+			beta * stable_vm_log(M_PI_2 * W * cosV / (M_PI_2 + beta * V));
+		rnd[i] = shift + c * X / M_PI_2;
+	}
+}
+
+void stable_rnd_transform_GAUSS(const StableDist *dist, const double u[],
+								const double w[], double rnd[], int n)
+{
+	const double c = 2 * dist->sigma, shift = dist->mu_1;
+	int i;
 
 	for (i = 0; i < n; i++)
-		rnd[i] = stable_rnd_point(dist);
+		rnd[i] = shift + c * stable_vm_sqrt(-stable_vm_log(w[i])) *
+				 stable_vm_cos(2 * M_PI * (u[i] - 0.5));
+}
+
+void stable_rnd_transform_CAUCHY(const StableDist *dist, const double u[],
+								 const double w[], double rnd[], int n)
+{
+	const double c = dist->sigma, shift = dist->mu_1;
+	double V;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		V = M_PI * (u[i] - 0.5);
+		rnd[i] = shift + c * stable_vm_sin(V) / stable_vm_cos(V);
+	}
+}
+
+void stable_rnd_transform_LEVY(const StableDist *dist, const double u[],
+							   const double w[], double rnd[], int n)
+{
+	const double c = dist->beta * dist->sigma, shift = dist->mu_1;
+	double Z;
+	int i;
+
+	for (i = 0; i < n; i++) {
+		Z = stable_vm_cos(2 * M_PI * (u[i] - 0.5));
+		rnd[i] = shift + c / (-2 * stable_vm_log(w[i]) * Z * Z);
+	}
+}
+
+double
+stable_rnd_point(StableDist *dist)
+{
+	double u, w, rnd;
+
+	_rnd_philox(dist->rnd_key, dist->rnd_stream, dist->rnd_index++, &u, &w, 1);
+	if (stable_table_rnd_ready(dist))
+		stable_rnd_transform_TABLE(dist, &u, &w, &rnd, 1);
+	else
+		dist->stable_rnd_transform(dist, &u, &w, &rnd, 1);
+
+	return rnd;
+}
+
+/* Variates first, ..., first + n - 1 of the stream on the calling thread, from
+   the Sobol points of qmc instead if it is not NULL (or just the probabilities
+   of stable_inv, if qmc->inv is set) */
+static void _rnd_fill(const StableDist *dist, const struct _rnd_qmc *qmc,
+					  uint64_t stream, uint64_t first, double rnd[], size_t n)
+{
+	double u[STABLE_RND_BLOCK], w[STABLE_RND_BLOCK];
+	size_t i, len;
+	void (*transform)(const StableDist *, const double[], const double[], double[], int);
+
+	transform = stable_table_rnd_ready(dist) ? &stable_rnd_transform_TABLE :
+				dist->stable_rnd_transform;
+
+	for (i = 0; i < n; i += len) {
+		len = min(STABLE_RND_BLOCK, n - i);
+
+		if (qmc == NULL)
+			_rnd_philox(dist->rnd_key, stream, first + i, u, w, len);
+		else if (qmc->inv) {
+			_rnd_sobol(qmc, first + i, rnd + i, NULL, len);
+			continue;
+		} else
+			_rnd_sobol(qmc, first + i, u, w, len);
+
+		transform(dist, u, w, rnd + i, len);
+	}
+}
+
+static void _rnd_job(struct stable_worker *worker, void *ptr_args)
+{
+	struct _rnd_args *args = (struct _rnd_args *)ptr_args;
+	unsigned int first;
+	int b, end;
+
+	while (stable_pool_take(worker, &args->next, args->blocks, &b, &end)) {
+		for (; b < end; b++) {
+			first = (unsigned int)b * STABLE_RND_BLOCK;
+
+			_rnd_fill(args->dist, args->qmc, args->stream, args->first + first,
+					  args->rnd + first, min(STABLE_RND_BLOCK, args->n - first));
+		}
+	}
+}
+
+short stable_rnd_stream(const StableDist *dist, uint64_t stream, uint64_t first,
+						double *rnd, const unsigned int n)
+{
+	struct _rnd_args args;
+	struct stable_config cfg;
+
+	if (rnd == NULL && n > 0)
+		return -1;
+
+	args.dist = dist;
+	args.rnd = rnd;
+	args.n = n;
+	args.stream = stream;
+	args.first = first;
+	args.qmc = NULL;
+	args.blocks = (n + STABLE_RND_BLOCK - 1) / STABLE_RND_BLOCK;
+	args.next = 0;
+
+	stable_get_config(dist, &cfg);
+	stable_pool_run(args.blocks > 1 ? cfg.THREADS : 1, _rnd_job, &args);
+
+	return 0;
+}
+
+short
+stable_rnd(StableDist *dist, double *rnd, const unsigned int n)
+{
+	if (stable_rnd_stream(dist, dist->rnd_stream, dist->rnd_index, rnd, n))
+		return -1;
+
+	dist->rnd_index += n;
+
+	return 0;
+}
+
+short stable_rnd_qmc(StableDist *dist, double *rnd, const unsigned int n, int mode)
+{
+	struct _rnd_args args;
+	struct _rnd_qmc qmc;
+	struct stable_config cfg;
+
+	if (rnd == NULL && n > 0)
+		return -1;
+
+	_rnd_qmc_init(&qmc, dist, mode);
+
+	args.dist = dist;
+	args.rnd = rnd;
+	args.n = n;
+	args.stream = dist->rnd_stream;
+	args.first = dist->rnd_index;
+	args.qmc = &qmc;
+	args.blocks = (n + STABLE_RND_BLOCK - 1) / STABLE_RND_BLOCK;
+	args.next = 0;
+
+	stable_get_config(dist, &cfg);
+	stable_pool_run(args.blocks > 1 && !qmc.inv ? cfg.THREADS : 1, _rnd_job, &args);
+
+	/* Quantiles of the probabilities, in place */
+	if (qmc.inv)
+		stable_inv(dist, rnd, n, rnd, NULL);
+
+	dist->rnd_index += n;
+
+	return 0;
+}
+
+struct stable_rnd_iter {
+	StableDist *dist;   // Copy of the distribution, read by the refill threads
+	uint64_t stream;
+	uint64_t first;     // Index in the stream of the first variate
+	size_t block;       // Variates per slot
+	unsigned int slots;
+	double *ring;       // slots x block variates
+	uint64_t *filled;   // Block held by each slot, UINT64_MAX while empty
+	uint64_t next_fill; // Next block to be generated
+	uint64_t current;   // Block being read, in slot current % slots
+	size_t offset;      // Variates of the current block already read
+	unsigned int threads;
+	pthread_t *refill;
+	pthread_mutex_t lock;
+	pthread_cond_t space;  // A slot was freed, or the iterator is stopping
+	pthread_cond_t ready;  // A block was generated
+	short stop;
+};
+
+static void *_rnd_iter_refill(void *ptr_args)
+{
+	struct stable_rnd_iter *it = (struct stable_rnd_iter *)ptr_args;
+	uint64_t k;
+
+	pthread_mutex_lock(&it->lock);
+
+	while (!it->stop) {
+		/* Block current + slots would go to the slot being read */
+		if (it->next_fill >= it->current + it->slots) {
+			pthread_cond_wait(&it->space, &it->lock);
+			continue;
+		}
+
+		k = it->next_fill++;
+		pthread_mutex_unlock(&it->lock);
+
+		_rnd_fill(it->dist, NULL, it->stream, it->first + k * it->block,
+				  it->ring + (k % it->slots) * it->block, it->block);
+
+		pthread_mutex_lock(&it->lock);
+		it->filled[k % it->slots] = k;
+		pthread_cond_broadcast(&it->ready);
+	}
+
+	pthread_mutex_unlock(&it->lock);
+
+	return NULL;
+}
+
+static void _rnd_iter_stop(struct stable_rnd_iter *it)
+{
+	unsigned int k;
+
+	pthread_mutex_lock(&it->lock);
+	it->stop = 1;
+	pthread_cond_broadcast(&it->space);
+	pthread_mutex_unlock(&it->lock);
+
+	for (k = 0; k < it->threads; k++)
+		pthread_join(it->refill[k], NULL);
+
+	it->threads = 0;
+}
+
+void stable_rnd_iter_free(struct stable_rnd_iter *it)
+{
+	if (it == NULL)
+		return;
+
+	_rnd_iter_stop(it);
+
+	pthread_mutex_destroy(&it->lock);
+	pthread_cond_destroy(&it->space);
+	pthread_cond_destroy(&it->ready);
+
+	stable_free(it->dist);
+	free(it->ring);
+	free(it->filled);
+	free(it->refill);
+	free(it);
+}
+
+struct stable_rnd_iter *stable_rnd_iter_create(const StableDist *dist, size_t block,
+		unsigned int slots)
+{
+	struct stable_rnd_iter *it;
+	struct stable_config cfg;
+	unsigned int k, threads;
+
+	stable_get_config(dist, &cfg);
+	threads = max(cfg.THREADS, 1);
+
+	if (block == 0)
+		block = STABLE_RND_ITER_BLOCK;
+
+	if (slots == 0)
+		slots = 4 * threads;
+
+	slots = max(slots, 2);
+
+	if ((it = calloc(1, sizeof(struct stable_rnd_iter))) == NULL)
+		return NULL;
+
+	it->dist = stable_copy((StableDist *)dist);
+	it->ring = malloc(slots * block * sizeof(double));
+	it->filled = malloc(slots * sizeof(uint64_t));
+	it->refill = malloc(threads * sizeof(pthread_t));
+
+	pthread_mutex_init(&it->lock, NULL);
+	pthread_cond_init(&it->space, NULL);
+	pthread_cond_init(&it->ready, NULL);
+
+	if (it->dist == NULL || it->ring == NULL || it->filled == NULL || it->refill == NULL) {
+		stable_rnd_iter_free(it);
+		return NULL;
+	}
+
+	it->stream = dist->rnd_stream;
+	it->first = dist->rnd_index;
+	it->block = block;
+	it->slots = slots;
+
+	for (k = 0; k < slots; k++)
+		it->filled[k] = UINT64_MAX;
+
+	for (k = 0; k < threads; k++) {
+		if (pthread_create(&it->refill[k], NULL, _rnd_iter_refill, it)) {
+			perror("Error en la creacion de hilo");
+			stable_rnd_iter_free(it);
+			return NULL;
+		}
+
+		it->threads = k + 1;
+	}
+
+	return it;
+}
+
+/* Moves on to the next block if the current one was read, and waits until it
+   is generated. Returns the unread part of the current block */
+static const double *_rnd_iter_wait(struct stable_rnd_iter *it)
+{
+	pthread_mutex_lock(&it->lock);
+
+	if (it->offset == it->block) {
+		it->current++;
+		it->offset = 0;
+		pthread_cond_broadcast(&it->space);
+	}
+
+	while (it->filled[it->current % it->slots] != it->current)
+		pthread_cond_wait(&it->ready, &it->lock);
+
+	pthread_mutex_unlock(&it->lock);
+
+	return it->ring + (it->current % it->slots) * it->block + it->offset;
+}
+
+size_t stable_rnd_iter_next(struct stable_rnd_iter *it, const double **rnd)
+{
+	size_t n;
+
+	*rnd = _rnd_iter_wait(it);
+	n = it->block - it->offset;
+	it->offset = it->block;
+
+	return n;
+}
+
+short stable_rnd_iter_read(struct stable_rnd_iter *it, double *rnd, size_t n)
+{
+	const double *src;
+	size_t len;
+
+	if (rnd == NULL && n > 0)
+		return -1;
+
+	while (n > 0) {
+		src = _rnd_iter_wait(it);
+		len = min(n, it->block - it->offset);
+
+		memcpy(rnd, src, len * sizeof(double));
+		it->offset += len;
+		rnd += len;
+		n -= len;
+	}
 
-	return;
+	return 0;
 }
 
 short stable_rnd_gpu(StableDist *dist, double *rnd, const unsigned int n)
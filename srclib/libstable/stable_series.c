@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stable_api.h"
+#include "stable_series.h"
+
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include <gsl/gsl_sf_gamma.h>
+#include <gsl/gsl_sf_psi.h>
+
+#define STABLE_SERIES_REACH_STEP 1.2   // Growth of y while looking for the reach
+#define STABLE_SERIES_REACH_MAX 1e300
+#define STABLE_CENTER_LOG_MAX 700.0   // Larger coefficients are left out
+
+void stable_tail_series_init(struct stable_tail_series *series,
+							 const StableDist *dist, int function, short left)
+{
+	double theta0 = left ? -dist->theta0 : dist->theta0;
+	double s, sign = 1.0, fact;
+	int k, j;
+
+	memset(series, 0, sizeof(struct stable_tail_series));
+	series->function = function;
+	series->alfa = dist->alfa;
+	series->r = sqrt(1.0 + dist->xi * dist->xi);
+	series->c = (left ? -2.0 : 2.0) * dist->beta * M_1_PI;
+	series->zero = dist->beta == (left ? 1.0 : -1.0);
+
+	if (series->zero)
+		return;
+
+	if (dist->alfa == 1.0) {
+		/* Polygamma functions at the first argument, then by recurrence
+		   psi^(j)(s + 1) = psi^(j)(s) + (-1)^j j! / s^(j + 1) */
+		s = function == PDF ? 2.0 : 1.0;
+
+		for (j = 0; j < STABLE_SERIES_TERMS; j++)
+			series->psi[j][0] = gsl_sf_psi_n(j, s);
+
+		for (k = 1; k <= STABLE_SERIES_TERMS; k++, s += 1.0) {
+			series->lgam[k - 1] = gsl_sf_lngamma(s);
+
+			if (k == STABLE_SERIES_TERMS)
+				break;
+
+			for (j = 0, fact = 1.0; j < STABLE_SERIES_TERMS; j++) {
+				series->psi[j][k] = series->psi[j][k - 1] +
+									(j % 2 ? -fact : fact) / pow(s, j + 1);
+				fact *= j + 1;
+			}
+		}
+
+		return;
+	}
+
+	for (k = 1; k <= STABLE_SERIES_TERMS; k++) {
+		s = function == PDF ? dist->alfa * k + 1.0 : dist->alfa * k;
+		series->coef[k - 1] = sign * M_1_PI * exp(gsl_sf_lngamma(s) - gsl_sf_lngamma(k + 1.0))
+							  * sin(dist->alfa * k * (M_PI_2 + theta0));
+		sign = -sign;
+	}
+}
+
+/* Terms with alfa = 1. Term n is (-1)^n/n! sum_m C(n,m) (ic)^m g^(m)(s), with
+ * g(s) = Gamma(s) y^(-s) exp(-i pi s/2), whose derivatives are g times G_m,
+ * G_m = sum_j C(m-1,j) h^(j+1) G_(m-1-j), h = log(g). The PDF is the real part
+ * of the sum (s = n + 1) and the tail probability the imaginary one (s = n). */
+static double _tail_series_alfa1(const struct stable_tail_series *series,
+								 double y, double *err)
+{
+	double complex G[STABLE_SERIES_TERMS + 1], H[STABLE_SERIES_TERMS + 1];
+	double complex inner, icm, sum = 0, last = 0, prev = 0;
+	double binom[STABLE_SERIES_TERMS + 1][STABLE_SERIES_TERMS + 1];
+	double L = log(y), fact = 1.0, s;
+	int n, m, j;
+
+	for (n = 0; n <= STABLE_SERIES_TERMS; n++) {
+		binom[n][0] = binom[n][n] = 1.0;
+
+		for (m = 1; m < n; m++)
+			binom[n][m] = binom[n - 1][m - 1] + binom[n - 1][m];
+	}
+
+	for (n = 1; n <= STABLE_SERIES_TERMS; n++) {
+		s = series->function == PDF ? n + 1 : n;
+		fact *= n;
+
+		H[1] = series->psi[0][n - 1] - L - I * M_PI_2;
+
+		for (j = 2; j <= n; j++)
+			H[j] = series->psi[j - 1][n - 1];
+
+		G[0] = 1.0;
+
+		for (m = 1; m <= n; m++) {
+			G[m] = 0;
+
+			for (j = 0; j < m; j++)
+				G[m] += binom[m - 1][j] * H[j + 1] * G[m - 1 - j];
+		}
+
+		inner = 0;
+		icm = 1.0;
+
+		for (m = 0; m <= n; m++) {
+			inner += binom[n][m] * icm * G[m];
+			icm *= I * series->c;
+		}
+
+		prev = last;
+		last = (n % 2 ? -1.0 : 1.0) / fact * exp(series->lgam[n - 1] - s * L)
+			   * cexp(-I * M_PI_2 * s) * inner;
+		sum += last;
+	}
+
+	*err = M_1_PI * (cabs(last) + cabs(prev));
+
+	return M_1_PI * (series->function == PDF ? creal(sum) : cimag(sum));
+}
+
+double stable_tail_series_eval(const struct stable_tail_series *series,
+							   double y, double *err)
+{
+	double w, p, term = 0, prev = 0, sum = 0;
+	int k;
+
+	if (series->zero) {
+		*err = 0;
+		return 0;
+	}
+
+	if (series->alfa == 1.0)
+		return _tail_series_alfa1(series, y, err);
+
+	w = series->r * pow(y, -series->alfa);
+	p = series->function == PDF ? w / y : w;
+
+	for (k = 0; k < STABLE_SERIES_TERMS; k++) {
+		prev = term;
+		term = series->coef[k] * p;
+		sum += term;
+		p *= w;
+	}
+
+	/* Coefficients vanish for some k, so the truncation error is estimated
+	   with the last two terms. */
+	*err = fabs(term) + fabs(prev);
+
+	return sum;
+}
+
+/* Smallest distance to xi from which the series keeps a relative error under
+ * tol (several consecutive steps, as the estimate can vanish by chance). */
+double stable_tail_series_reach(const struct stable_tail_series *series, double tol)
+{
+	double y, v, err;
+	int ok = 0;
+
+	for (y = 1.0; y < STABLE_SERIES_REACH_MAX; y *= STABLE_SERIES_REACH_STEP) {
+		v = stable_tail_series_eval(series, y, &err);
+
+		if (err <= tol * fabs(v)) {
+			if (++ok == STABLE_SERIES_CHECKS)
+				return y / pow(STABLE_SERIES_REACH_STEP, STABLE_SERIES_CHECKS - 1);
+		} else
+			ok = 0;
+	}
+
+	return STABLE_SERIES_REACH_MAX;
+}
+
+/* Value of the series at a distance y to xi, only if its relative error keeps
+ * under tol there and at the previous steps towards xi, as in the reach.
+ * Returns 0 when the numerical integration has to be used instead. */
+short stable_tail_series_point(const struct stable_tail_series *series,
+							   double y, double tol, double *value, double *err)
+{
+	double v, e;
+	int k;
+
+	if (series->zero || !(y >= 1.0))
+		return 0;
+
+	for (k = 0; k < STABLE_SERIES_CHECKS; k++, y /= STABLE_SERIES_REACH_STEP) {
+		v = stable_tail_series_eval(series, y, &e);
+
+		if (!(e <= tol * fabs(v)))
+			return 0;
+
+		if (k == 0) {
+			*value = v;
+			*err = e;
+		}
+	}
+
+	return 1;
+}
+
+void stable_center_series_init(struct stable_center_series *series,
+							   const StableDist *dist, int function)
+{
+	double phi0 = -dist->alfa * dist->theta0;
+	double logr = 0.5 * log(1.0 + dist->xi * dist->xi);
+	double s, lc;
+	unsigned int k;
+
+	memset(series, 0, sizeof(struct stable_center_series));
+	series->function = function;
+	series->usable = dist->alfa > 1.0 || fabs(dist->beta) < 1.0;
+	series->value0 = function == PDF ? 0.0 : 0.5 - dist->theta0 * M_1_PI;
+
+	for (k = 0; k < STABLE_CENTER_TERMS; k++) {
+		s = (k + 1.0) / dist->alfa;
+		lc = gsl_sf_lngamma(s) - gsl_sf_lngamma(k + (function == PDF ? 1.0 : 2.0)) - s * logr;
+
+		if (lc > STABLE_CENTER_LOG_MAX)
+			break;
+
+		series->coef[k] = exp(lc) * cos(k * M_PI_2 + phi0 * s) / (M_PI * dist->alfa);
+	}
+
+	series->terms = k;
+}
+
+/* Value of the series at y = x - xi, summed until the last two terms are under
+ * tol relative to the sum. Returns 0 when that does not happen, so the
+ * numerical integration has to be used instead. */
+short stable_center_series_point(const struct stable_center_series *series,
+								 double y, double tol, double *value, double *err)
+{
+	double p = series->function == PDF ? 1.0 : y;
+	double sum = series->value0, term, prev = 0, e;
+	unsigned int k;
+
+	if (!series->usable)
+		return 0;
+
+	for (k = 0; k < series->terms; k++) {
+		term = series->coef[k] * p;
+		sum += term;
+		p *= y;
+		e = fabs(term) + fabs(prev);
+
+		if (!isfinite(e))
+			return 0;
+
+		if (k > 1 && sum != 0 && e <= tol * fabs(sum)) {
+			*value = sum;
+			*err = e;
+			return 1;
+		}
+
+		prev = term;
+	}
+
+	return 0;
+}
@@ -0,0 +1,1001 @@
+/*
+ * Copyright (C) 2015 - Naudit High Performance Computing and Networking
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "stable_table.h"
+#include "stable_kernels.h"
+#include "benchmarking.h"
+
+#include <math.h>
+
+struct _table_interval {
+	double a, b;
+	unsigned int depth;
+};
+
+typedef void (*_table_evaluator)(StableDist *, const double *, const int, double *, double *);
+
+static int _compare_pieces(const void *a, const void *b)
+{
+	double da = ((const struct stable_table_piece *) a)->a;
+	double db = ((const struct stable_table_piece *) b)->a;
+
+	return (da > db) - (da < db);
+}
+
+static double _cheb_node(unsigned int j)
+{
+	return cos(M_PI * (j + 0.5) / STABLE_TABLE_ORDER);
+}
+
+// Test points lay between the nodes, where the interpolation error peaks.
+static double _cheb_test(unsigned int m)
+{
+	static const double pos[STABLE_TABLE_TESTS] = { 1, STABLE_TABLE_ORDER / 2, STABLE_TABLE_ORDER - 1 };
+
+	return cos(M_PI * pos[m] / STABLE_TABLE_ORDER);
+}
+
+static void _cheb_fit(const double *f, double *c)
+{
+	unsigned int j, k;
+	double sum;
+
+	for (k = 0; k < STABLE_TABLE_ORDER; k++) {
+		sum = 0;
+
+		for (j = 0; j < STABLE_TABLE_ORDER; j++)
+			sum += f[j] * cos(M_PI * k * (j + 0.5) / STABLE_TABLE_ORDER);
+
+		c[k] = 2.0 * sum / STABLE_TABLE_ORDER;
+	}
+}
+
+static double _cheb_eval(const double *c, double t)
+{
+	double b0, b1 = 0, b2 = 0;
+	int k;
+
+	for (k = STABLE_TABLE_ORDER - 1; k > 0; k--) {
+		b0 = 2.0 * t * b1 - b2 + c[k];
+		b2 = b1;
+		b1 = b0;
+	}
+
+	return t * b1 - b2 + 0.5 * c[0];
+}
+
+static double _log_value(double v)
+{
+	if (!(v > 0))   // Also catches NaN
+		return STABLE_TABLE_LOG_MIN;
+
+	v = log(v);
+
+	return max(v, STABLE_TABLE_LOG_MIN);
+}
+
+static double _relative_error(double approx, double exact)
+{
+	if (!(exact >= 0))
+		return 0;
+
+	return fabs(approx - exact) / max(exact, STABLE_TABLE_FLOOR);
+}
+
+static void _table_free_half(struct stable_table_half *half)
+{
+	free(half->pieces);
+	free(half->lookup);
+	memset(half, 0, sizeof(struct stable_table_half));
+}
+
+static void _table_free_fn(struct stable_table_fn *fn)
+{
+	_table_free_half(&fn->half[0]);
+	_table_free_half(&fn->half[1]);
+	fn->built = 0;
+}
+
+static void _table_free_rnd(struct stable_table_rnd *rnd)
+{
+	free(rnd->y);
+	free(rnd->m);
+	memset(rnd, 0, sizeof(struct stable_table_rnd));
+}
+
+static double _table_eval_half(const struct stable_table_half *half, double d, double *rel_err)
+{
+	const struct stable_table_piece *piece;
+	double u = -asinh(d), t;
+	unsigned int k, i;
+
+	if (d > half->dmax) {
+		*rel_err = half->tail_err;
+		return stable_tail_series_eval(&half->tail, d + half->shift, &t);
+	}
+
+	k = (unsigned int)((u - half->umin) * half->scale);
+
+	if (k >= half->cells)
+		k = half->cells - 1;
+
+	for (i = half->lookup[k]; i + 1 < half->n && u > half->pieces[i].b; i++);
+
+	piece = &half->pieces[i];
+	t = (2.0 * u - piece->a - piece->b) / (piece->b - piece->a);
+	*rel_err = piece->err;
+
+	return exp(_cheb_eval(piece->c, t));
+}
+
+/* Short tails of totally skewed distributions have no expansion, so the half
+ * goes on until the function is negligible. The end is found by bisection, so
+ * the last interval does not hold the abrupt fall to 0 of the logarithm. */
+static double _table_zero_reach(StableDist *std, _table_evaluator eval,
+								double center, struct stable_table_info *info)
+{
+	double d, lo, z, v, err;
+	int k;
+
+	for (d = 1.0; d < STABLE_TABLE_ZERO_REACH; d *= 2.0) {
+		z = center - d;
+		eval(std, &z, 1, &v, &err);
+		info->evaluations++;
+
+		if (!(v > STABLE_TABLE_FLOOR))
+			break;
+	}
+
+	for (k = 0, lo = 0.5 * d; k < STABLE_TABLE_ZERO_ITER; k++) {
+		z = center - 0.5 * (lo + d);
+		eval(std, &z, 1, &v, &err);
+		info->evaluations++;
+
+		if (v > STABLE_TABLE_FLOOR)
+			lo = 0.5 * (lo + d);
+		else
+			d = 0.5 * (lo + d);
+	}
+
+	return lo;
+}
+
+/* Fits the Chebyshev expansions of one half, evaluating at once the nodes of
+ * all the intervals pending at each level of refinement so the evaluation is
+ * shared among the threads as in any other batch. */
+static short _table_build_half(StableDist *std, int function, double center,
+							   double tol, struct stable_table_half *half,
+							   struct stable_table_info *info)
+{
+	_table_evaluator eval = function == PDF ? &stable_pdf : &stable_cdf;
+	const unsigned int per_piece = STABLE_TABLE_ORDER + STABLE_TABLE_TESTS;
+	struct _table_interval *pending, *next, *swap;
+	struct stable_table_piece *piece;
+	unsigned int npending, nnext, i, j, k, npoints;
+	double *z = NULL, *val = NULL, *err = NULL, lf[STABLE_TABLE_ORDER];
+	double u, e, rel;
+	short error = -1;
+
+	memset(half, 0, sizeof(struct stable_table_half));
+
+	/* The left tail of this distribution. Distances y to xi are d + shift. */
+	stable_tail_series_init(&half->tail, std, function, 1);
+	half->shift = std->xi - center;
+
+	if (half->tail.zero)
+		half->dmax = _table_zero_reach(std, eval, center, info);
+	else
+		half->dmax = stable_tail_series_reach(&half->tail, 0.1 * tol) - half->shift;
+
+	half->dmax = max(half->dmax, 1.0);
+	half->umin = -asinh(half->dmax);
+
+	pending = malloc(STABLE_TABLE_MAX_PIECES * sizeof(struct _table_interval));
+	next = malloc(STABLE_TABLE_MAX_PIECES * sizeof(struct _table_interval));
+	half->pieces = malloc(STABLE_TABLE_MAX_PIECES * sizeof(struct stable_table_piece));
+	z = malloc(STABLE_TABLE_MAX_PIECES * per_piece * sizeof(double));
+	val = malloc(STABLE_TABLE_MAX_PIECES * per_piece * sizeof(double));
+	err = malloc(STABLE_TABLE_MAX_PIECES * per_piece * sizeof(double));
+
+	if (!pending || !next || !half->pieces || !z || !val || !err)
+		goto cleanup;
+
+	for (i = 0; i < STABLE_TABLE_INITIAL; i++) {
+		pending[i].a = half->umin * (1.0 - (double) i / STABLE_TABLE_INITIAL);
+		pending[i].b = half->umin * (1.0 - (double)(i + 1) / STABLE_TABLE_INITIAL);
+		pending[i].depth = 0;
+	}
+
+	npending = STABLE_TABLE_INITIAL;
+
+	while (npending > 0) {
+		npoints = npending * per_piece;
+
+		for (i = 0; i < npending; i++) {
+			for (j = 0; j < per_piece; j++) {
+				u = j < STABLE_TABLE_ORDER ? _cheb_node(j) : _cheb_test(j - STABLE_TABLE_ORDER);
+				u = 0.5 * (pending[i].a + pending[i].b) + 0.5 * (pending[i].b - pending[i].a) * u;
+				z[i * per_piece + j] = center + sinh(u);
+			}
+		}
+
+		eval(std, z, npoints, val, err);
+		info->evaluations += npoints;
+
+		for (i = 0, nnext = 0; i < npending; i++) {
+			piece = &half->pieces[half->n];
+
+			for (j = 0; j < STABLE_TABLE_ORDER; j++)
+				lf[j] = _log_value(val[i * per_piece + j]);
+
+			_cheb_fit(lf, piece->c);
+
+			for (k = 0, e = 0; k < STABLE_TABLE_TESTS; k++) {
+				rel = _relative_error(exp(_cheb_eval(piece->c, _cheb_test(k))),
+									  val[i * per_piece + STABLE_TABLE_ORDER + k]);
+				e = max(e, rel);
+			}
+
+			/* Keep the interval if it is precise enough, or if it can not be
+			   split anymore. The evaluation error of the integration also
+			   stops the refinement through the depth limit. */
+			if (e <= tol || pending[i].depth >= STABLE_TABLE_MAX_DEPTH ||
+				half->n + (npending - i) + nnext + 1 > STABLE_TABLE_MAX_PIECES) {
+				piece->a = pending[i].a;
+				piece->b = pending[i].b;
+				piece->err = e;
+				half->n++;
+				info->max_error = max(info->max_error, e);
+			} else {
+				u = 0.5 * (pending[i].a + pending[i].b);
+				next[nnext].a = pending[i].a;
+				next[nnext].b = u;
+				next[nnext].depth = pending[i].depth + 1;
+				next[nnext + 1].a = u;
+				next[nnext + 1].b = pending[i].b;
+				next[nnext + 1].depth = pending[i].depth + 1;
+				nnext += 2;
+			}
+		}
+
+		swap = pending;
+		pending = next;
+		next = swap;
+		npending = nnext;
+	}
+
+	qsort(half->pieces, half->n, sizeof(struct stable_table_piece), _compare_pieces);
+	piece = realloc(half->pieces, half->n * sizeof(struct stable_table_piece));
+
+	if (piece != NULL)
+		half->pieces = piece;
+
+	half->cells = 4 * half->n;
+	half->scale = half->cells / -half->umin;
+	half->lookup = malloc(half->cells * sizeof(unsigned int));
+
+	if (half->lookup == NULL)
+		goto cleanup;
+
+	for (k = 0, i = 0; k < half->cells; k++) {
+		u = half->umin + k / half->scale;
+
+		while (i + 1 < half->n && u >= half->pieces[i].b)
+			i++;
+
+		half->lookup[k] = i;
+	}
+
+	/* The tail takes over with its truncation error, or with its difference
+	   to the table where both meet if it is larger. */
+	if (half->tail.zero)
+		half->tail_err = 0;
+	else {
+		u = stable_tail_series_eval(&half->tail, half->dmax + half->shift, &rel);
+		e = _relative_error(u, exp(_cheb_eval(half->pieces[0].c, -1.0)));
+		half->tail_err = max(e, rel / max(fabs(u), STABLE_TABLE_FLOOR));
+	}
+
+	info->max_error = max(info->max_error, half->tail_err);
+	info->pieces += half->n;
+	info->memory += half->n * sizeof(struct stable_table_piece) + half->cells * sizeof(unsigned int);
+
+	error = 0;
+
+cleanup:
+	free(pending);
+	free(next);
+	free(z);
+	free(val);
+	free(err);
+
+	if (error)
+		_table_free_half(half);
+
+	return error;
+}
+
+static short _table_copy_half(const struct stable_table_half *src, struct stable_table_half *dst)
+{
+	*dst = *src;
+	dst->pieces = malloc(src->n * sizeof(struct stable_table_piece));
+	dst->lookup = malloc(src->cells * sizeof(unsigned int));
+
+	if (dst->pieces == NULL || dst->lookup == NULL) {
+		_table_free_half(dst);
+		return -1;
+	}
+
+	memcpy(dst->pieces, src->pieces, src->n * sizeof(struct stable_table_piece));
+	memcpy(dst->lookup, src->lookup, src->cells * sizeof(unsigned int));
+
+	return 0;
+}
+
+// Halves meet at the median, where neither tail probability is small.
+static double _table_center(const StableDist *std)
+{
+	double err, center = stable_inv_point(std, 0.5, &err);
+
+	return isfinite(center) ? center : std->xi;
+}
+
+static short _table_ready(const StableDist *dist, int function)
+{
+	return dist->table != NULL && dist->table->alfa == dist->alfa &&
+		   dist->table->beta == dist->beta && dist->table->fn[function].built;
+}
+
+short stable_table_build(StableDist *dist, int function, double tol)
+{
+	struct stable_config cfg;
+	struct stable_table_fn *fn = NULL;
+	StableDist *std[2] = { NULL, NULL };
+	double center;
+	short error = -1;
+	int k;
+
+	if (function != PDF && function != CDF)
+		return -1;
+
+	// Closed forms are already as fast as the table.
+	if (dist->ZONE == GAUSS || dist->ZONE == CAUCHY || dist->ZONE == LEVY)
+		return 0;
+
+	if (dist->table != NULL && (dist->table->alfa != dist->alfa || dist->table->beta != dist->beta))
+		stable_table_free(dist);
+
+	stable_get_config(dist, &cfg);
+
+	if (tol <= 0)
+		tol = cfg.relTOL;
+
+	tol = max(tol, STABLE_TABLE_MIN_TOL);
+
+	for (k = 0; k < 2; k++) {
+		std[k] = stable_create(dist->alfa, k == 0 ? dist->beta : -dist->beta, 1.0, 0.0, 0);
+
+		if (std[k] == NULL)
+			goto cleanup;
+
+		stable_set_config(std[k], &cfg);
+	}
+
+	if (dist->table == NULL) {
+		dist->table = calloc(1, sizeof(struct stable_table));
+
+		if (dist->table == NULL)
+			goto cleanup;
+
+		dist->table->alfa = dist->alfa;
+		dist->table->beta = dist->beta;
+		dist->table->center = _table_center(std[0]);
+	}
+
+	fn = &dist->table->fn[function];
+	_table_free_fn(fn);
+	memset(&fn->info, 0, sizeof(struct stable_table_info));
+	fn->info.tol = tol;
+	benchmark_begin(&fn->info.build_time);
+
+	for (k = 0; k < 2; k++) {
+		center = k == 0 ? dist->table->center : -dist->table->center;
+
+		if (k == 1 && dist->beta == 0) {
+			if (_table_copy_half(&fn->half[0], &fn->half[1]))
+				goto cleanup;
+
+			fn->info.pieces += fn->half[1].n;
+			fn->info.memory += fn->half[1].n * sizeof(struct stable_table_piece)
+							   + fn->half[1].cells * sizeof(unsigned int);
+			break;
+		}
+
+		if (_table_build_half(std[k], function, center, tol, &fn->half[k], &fn->info))
+			goto cleanup;
+	}
+
+	fn->info.memory += sizeof(struct stable_table_fn);
+	fn->built = 1;
+	error = 0;
+
+cleanup:
+	if (fn != NULL) {
+		benchmark_end(&fn->info.build_time);
+
+		if (error)
+			_table_free_fn(fn);
+	}
+
+	stable_free(std[0]);
+	stable_free(std[1]);
+
+	return error;
+}
+
+short stable_table_info(const StableDist *dist, int function,
+						struct stable_table_info *info)
+{
+	if ((function != PDF && function != CDF) || !_table_ready(dist, function))
+		return -1;
+
+	*info = dist->table->fn[function].info;
+
+	return 0;
+}
+
+void stable_table_free(StableDist *dist)
+{
+	if (dist->table == NULL)
+		return;
+
+	_table_free_fn(&dist->table->fn[CDF]);
+	_table_free_fn(&dist->table->fn[PDF]);
+	_table_free_rnd(&dist->table->rnd);
+	free(dist->table);
+	dist->table = NULL;
+}
+
+static void _table_eval(const StableDist *dist, int function, const double x[],
+						const int Nx, double *out, double *err)
+{
+	const struct stable_table_fn *fn = &dist->table->fn[function];
+	double d, v = 0, rel;
+	int i;
+
+	for (i = 0; i < Nx; i++) {
+		d = (x[i] - dist->mu_0) / dist->sigma - dist->table->center;
+
+		if (isnan(d)) {
+			out[i] = d;
+			rel = 0;
+		} else {
+			v = _table_eval_half(&fn->half[d > 0], fabs(d), &rel);
+
+			if (function == PDF)
+				out[i] = v = v / dist->sigma;
+			else
+				out[i] = d > 0 ? 1.0 - v : v;
+		}
+
+		if (err != NULL)
+			err[i] = rel * v;
+	}
+}
+
+void stable_pdf_table(StableDist *dist, const double x[], const int Nx,
+					  double *pdf, double *err)
+{
+	if (dist->ZONE == GAUSS || dist->ZONE == CAUCHY || dist->ZONE == LEVY ||
+		(!_table_ready(dist, PDF) && stable_table_build(dist, PDF, 0))) {
+		stable_pdf(dist, x, Nx, pdf, err);
+		return;
+	}
+
+	_table_eval(dist, PDF, x, Nx, pdf, err);
+}
+
+void stable_cdf_table(StableDist *dist, const double x[], const int Nx,
+					  double *cdf, double *err)
+{
+	if (dist->ZONE == GAUSS || dist->ZONE == CAUCHY || dist->ZONE == LEVY ||
+		(!_table_ready(dist, CDF) && stable_table_build(dist, CDF, 0))) {
+		stable_cdf(dist, x, Nx, cdf, err);
+		return;
+	}
+
+	_table_eval(dist, CDF, x, Nx, cdf, err);
+}
+
+/* Value and derivative of a Chebyshev expansion at t, from the recurrences of
+ * T_k and of their derivatives k U_(k-1). */
+static double _cheb_eval_deriv(const double *c, double t, double *deriv)
+{
+	double T0 = 1.0, T1 = t, U0 = 1.0, U1 = 2.0 * t, T2, U2;
+	double v = 0.5 * c[0] + c[1] * t, dv = c[1];
+	int k;
+
+	for (k = 2; k < STABLE_TABLE_ORDER; k++) {
+		T2 = 2.0 * t * T1 - T0;
+		U2 = 2.0 * t * U1 - U0;
+		v += c[k] * T2;
+		dv += c[k] * k * U1;
+		T0 = T1;
+		T1 = T2;
+		U0 = U1;
+		U1 = U2;
+	}
+
+	*deriv = dv;
+
+	return v;
+}
+
+static double _cheb_end(const double *c, double t)
+{
+	double v = 0.5 * c[0];
+	int k;
+
+	for (k = 1; k < STABLE_TABLE_ORDER; k++)
+		v += t < 0 && k % 2 ? -c[k] : c[k];
+
+	return v;
+}
+
+/* Distance d to the median where a half takes the value exp(lp), and the error
+ * of d from the relative error of the half there. The pieces are found by
+ * binary search and the expansion is inverted with Newton steps kept inside
+ * the bracket of the root. */
+static double _table_inv_half(const struct stable_table_half *half, double lp, double *d_err)
+{
+	const struct stable_table_piece *piece;
+	double lo, hi, flo, fhi, t, v, dv, u, y, ylo, yhi, slope;
+	unsigned int a = 0, b = half->n - 1, m;
+	int k;
+
+	if (lp < _cheb_end(half->pieces[0].c, -1.0)) {
+		/* Beyond the table: end of a short tail, or the tail expansion solved
+		   on log(y), where it is almost a straight line of slope -alfa */
+		if (half->tail.zero || !isfinite(lp)) {
+			*d_err = 0;
+			return half->tail.zero ? half->dmax : INFINITY;
+		}
+
+		ylo = log(half->dmax + half->shift);
+		flo = _log_value(stable_tail_series_eval(&half->tail, exp(ylo), &v)) - lp;
+		yhi = INFINITY;
+		slope = -half->tail.alfa;
+		y = ylo - flo / slope;
+
+		for (k = 0; k < STABLE_TABLE_INV_ITER; k++) {
+			fhi = _log_value(stable_tail_series_eval(&half->tail, exp(y), &v)) - lp;
+
+			if (fhi > 0) {
+				if (y != ylo)
+					slope = (fhi - flo) / (y - ylo);
+
+				ylo = y;
+				flo = fhi;
+			} else
+				yhi = y;
+
+			t = y - fhi / (slope < 0 ? slope : -half->tail.alfa);
+
+			if (!(t > ylo && t < yhi))
+				t = isfinite(yhi) ? 0.5 * (ylo + yhi) : ylo + 2.0 * (ylo - y + 1.0);
+
+			if (fabs(t - y) < STABLE_TABLE_INV_TOL * fabs(y) || fhi == 0)
+				break;
+
+			y = t;
+		}
+
+		y = exp(y);
+		*d_err = y * half->tail_err / half->tail.alfa;
+
+		return y - half->shift;
+	}
+
+	if (lp >= _cheb_end(half->pieces[b].c, 1.0)) {
+		*d_err = 0;
+		return 0.0;
+	}
+
+	while (a < b) {
+		m = (a + b) / 2;
+
+		if (_cheb_end(half->pieces[m].c, 1.0) < lp)
+			a = m + 1;
+		else
+			b = m;
+	}
+
+	piece = &half->pieces[a];
+	lo = -1.0;
+	hi = 1.0;
+	flo = _cheb_end(piece->c, -1.0) - lp;
+	fhi = _cheb_end(piece->c, 1.0) - lp;
+	t = flo < 0 && fhi > 0 ? -1.0 - 2.0 * flo / (fhi - flo) : 0.0;
+	dv = 0;
+
+	for (k = 0; k < STABLE_TABLE_INV_ITER; k++) {
+		v = _cheb_eval_deriv(piece->c, t, &dv) - lp;
+
+		if (v < 0)
+			lo = t;
+		else
+			hi = t;
+
+		v = t - v / dv;
+
+		if (!(v > lo && v < hi))
+			v = 0.5 * (lo + hi);
+
+		if (fabs(v - t) < STABLE_TABLE_INV_TOL) {
+			t = v;
+			break;
+		}
+
+		t = v;
+	}
+
+	u = 0.5 * (piece->a + piece->b) + 0.5 * (piece->b - piece->a) * t;
+	*d_err = dv > 0 ? cosh(u) * piece->err * (piece->b - piece->a) / (2.0 * dv) : 0.0;
+
+	return sinh(-u);
+}
+
+void stable_inv_table(StableDist *dist, const double q[], const int Nq,
+					  double *inv, double *err, short polish)
+{
+	const struct stable_table_fn *fn;
+	double d, d_err, *cdf = NULL, *pdf = NULL, step;
+	int i, right;
+
+	if (dist->ZONE == GAUSS || dist->ZONE == CAUCHY || dist->ZONE == LEVY ||
+		(!_table_ready(dist, CDF) && stable_table_build(dist, CDF, 0))) {
+		stable_inv(dist, q, Nq, inv, err);
+		return;
+	}
+
+	fn = &dist->table->fn[CDF];
+
+	for (i = 0; i < Nq; i++) {
+		if (!(q[i] >= 0 && q[i] <= 1)) {
+			inv[i] = NAN;
+			d_err = 0;
+		} else {
+			right = q[i] > 0.5;
+			d = _table_inv_half(&fn->half[right], right ? log1p(-q[i]) : log(q[i]), &d_err);
+			inv[i] = (dist->table->center + (right ? d : -d)) * dist->sigma + dist->mu_0;
+		}
+
+		if (err != NULL)
+			err[i] = d_err * dist->sigma;
+	}
+
+	if (!polish)
+		return;
+
+	/* One Newton step on the numerical integration for all the points */
+	cdf = malloc(Nq * sizeof(double));
+	pdf = malloc(Nq * sizeof(double));
+
+	if (cdf != NULL && pdf != NULL) {
+		stable_cdf(dist, inv, Nq, cdf, NULL);
+		stable_pdf(dist, inv, Nq, pdf, NULL);
+
+		for (i = 0; i < Nq; i++) {
+			if (!(isfinite(inv[i]) && pdf[i] > 0))
+				continue;
+
+			step = (cdf[i] - q[i]) / pdf[i];
+
+			if (isfinite(step)) {
+				inv[i] -= step;
+
+				if (err != NULL)
+					err[i] = fabs(step);
+			}
+		}
+	}
+
+	free(cdf);
+	free(pdf);
+}
+
+short stable_table_rnd_ready(const StableDist *dist)
+{
+	return dist->table != NULL && dist->table->alfa == dist->alfa &&
+		   dist->table->beta == dist->beta && dist->table->rnd.built;
+}
+
+short stable_table_rnd_copy(StableDist *dst, const StableDist *src)
+{
+	const struct stable_table_rnd *from;
+	struct stable_table_rnd *rnd;
+
+	if (!stable_table_rnd_ready(src))
+		return 0;
+
+	from = &src->table->rnd;
+
+	if (dst->table == NULL) {
+		dst->table = calloc(1, sizeof(struct stable_table));
+
+		if (dst->table == NULL)
+			return -1;
+
+		dst->table->alfa = src->table->alfa;
+		dst->table->beta = src->table->beta;
+		dst->table->center = src->table->center;
+	}
+
+	rnd = &dst->table->rnd;
+	_table_free_rnd(rnd);
+	rnd->y = malloc(from->n * sizeof(double));
+	rnd->m = malloc(from->n * sizeof(double));
+
+	if (rnd->y == NULL || rnd->m == NULL) {
+		_table_free_rnd(rnd);
+		return -1;
+	}
+
+	memcpy(rnd->y, from->y, from->n * sizeof(double));
+	memcpy(rnd->m, from->m, from->n * sizeof(double));
+	rnd->n = from->n;
+	rnd->tmin = from->tmin;
+	rnd->step = from->step;
+	rnd->info = from->info;
+	rnd->built = 1;
+
+	return 0;
+}
+
+/* asinh(x) at t, and step dy/dt if m is not NULL, of n nodes from tmin on.
+   Quantiles past the median are solved on the distribution with -beta, so
+   1 - q keeps its relative precision. stable_inv stops at a relative step of
+   1e-6, so its quantiles get a Newton step on the CDF. */
+static short _table_rnd_solve(StableDist *std[2], double tmin, double step,
+							  unsigned int n, double *y, double *m)
+{
+	double *q = malloc(n * sizeof(double)), *x = malloc(n * sizeof(double));
+	double *pdf = malloc(n * sizeof(double)), *cdf = malloc(n * sizeof(double)), t, dx;
+	unsigned int k, nl;
+	short error = -1;
+
+	if (q == NULL || x == NULL || pdf == NULL || cdf == NULL)
+		goto cleanup;
+
+	for (k = 0, nl = 0; k < n; k++) {
+		t = tmin + k * step;
+		q[k] = 1.0 / (1.0 + exp(fabs(t)));
+		nl += t <= 0;
+	}
+
+	stable_inv(std[0], q, nl, x, NULL);
+	stable_inv(std[1], q + nl, n - nl, x + nl, NULL);
+
+	stable_cdf(std[0], x, nl, cdf, NULL);
+	stable_cdf(std[1], x + nl, n - nl, cdf + nl, NULL);
+	stable_pdf(std[0], x, nl, pdf, NULL);
+	stable_pdf(std[1], x + nl, n - nl, pdf + nl, NULL);
+
+	for (k = 0; k < n; k++) {
+		t = tmin + k * step;
+		dx = (cdf[k] - q[k]) / pdf[k];
+
+		/* stable_inv leaves a residual of about INVrelTOL. A larger one comes
+		   from the CDF failing there, not from the quantile */
+		if (isfinite(dx) && fabs(cdf[k] - q[k]) < 1e-4 * q[k])
+			x[k] -= dx;
+
+		y[k] = k < nl ? asinh(x[k]) : -asinh(x[k]);
+
+		/* q (1 - q) = 1 / (2 + 2 cosh(t)) */
+		if (m != NULL)
+			m[k] = step / ((2.0 + 2.0 * cosh(t)) * pdf[k] * sqrt(1.0 + x[k] * x[k]));
+	}
+
+	/* Same for the slopes where the PDF fails: those far from the difference
+	   of the neighbours are replaced by it */
+	for (k = 1; m != NULL && k + 1 < n; k++) {
+		dx = 0.5 * (y[k + 1] - y[k - 1]);
+
+		if (!(fabs(m[k] - dx) <= 1e-2 * fabs(dx)))
+			m[k] = dx;
+	}
+
+	error = 0;
+
+cleanup:
+	free(q);
+	free(x);
+	free(pdf);
+	free(cdf);
+
+	return error;
+}
+
+/* Hermite interpolation of asinh(x) at t, linear with t past the end nodes */
+static inline double _table_rnd_interp(const double *y, const double *m, unsigned int n,
+									   double tmin, double inv_step, double t)
+{
+	const double last = n - 2.0;
+	double s = (t - tmin) * inv_step, f, fc, e, g;
+	int k;
+
+	f = s < 0 ? 0 : s;
+	k = (int)(f > last ? last : f);
+	f = s - k;
+	fc = f < 0 ? 0 : f;
+	fc = fc > 1 ? 1 : fc;
+	e = 1 - fc;
+	g = fc * fc;
+
+	return (1 + 2 * fc) * e * e * y[k] + fc * e * e * m[k] +
+		   g * (3 - 2 * fc) * y[k + 1] + g * (fc - 1) * m[k + 1] +
+		   (f - fc) * (f < 0 ? m[k] : m[k + 1]);
+}
+
+short stable_rnd_table_build(StableDist *dist, double tol)
+{
+	struct stable_config cfg;
+	struct stable_table_rnd *rnd = NULL;
+	StableDist *std[2] = { NULL, NULL };
+	double step, err, prev_error, *ymid = NULL;
+	unsigned int k, halving;
+	short error = -1;
+
+	// The transforms of the closed forms are already as fast as the table.
+	if (dist->ZONE == GAUSS || dist->ZONE == CAUCHY || dist->ZONE == LEVY)
+		return 0;
+
+	if (dist->table != NULL && (dist->table->alfa != dist->alfa || dist->table->beta != dist->beta))
+		stable_table_free(dist);
+
+	stable_get_config(dist, &cfg);
+
+	if (tol <= 0)
+		tol = cfg.relTOL;
+
+	/* Quantiles are solved from the CDF, which needs a smaller error */
+	cfg.relTOL = max(0.01 * tol, STABLE_TABLE_MIN_TOL);
+
+	for (k = 0; k < 2; k++) {
+		std[k] = stable_create(dist->alfa, k == 0 ? dist->beta : -dist->beta, 1.0, 0.0, 0);
+
+		if (std[k] == NULL)
+			goto cleanup;
+
+		stable_set_config(std[k], &cfg);
+	}
+
+	if (dist->table == NULL) {
+		dist->table = calloc(1, sizeof(struct stable_table));
+
+		if (dist->table == NULL)
+			goto cleanup;
+
+		dist->table->alfa = dist->alfa;
+		dist->table->beta = dist->beta;
+		dist->table->center = _table_center(std[0]);
+	}
+
+	rnd = &dist->table->rnd;
+	_table_free_rnd(rnd);
+	rnd->info.tol = tol;
+	benchmark_begin(&rnd->info.build_time);
+
+	for (halving = 0, step = STABLE_TABLE_RND_STEP; ; halving++, step *= 0.5) {
+		free(rnd->y);
+		free(rnd->m);
+		free(ymid);
+
+		rnd->n = (unsigned int)(2.0 * STABLE_TABLE_RND_TMAX / step + 0.5) + 1;
+		rnd->tmin = -STABLE_TABLE_RND_TMAX;
+		rnd->step = step;
+		rnd->y = malloc(rnd->n * sizeof(double));
+		rnd->m = malloc(rnd->n * sizeof(double));
+		ymid = malloc((rnd->n - 1) * sizeof(double));
+
+		if (rnd->y == NULL || rnd->m == NULL || ymid == NULL ||
+			_table_rnd_solve(std, rnd->tmin, step, rnd->n, rnd->y, rnd->m) ||
+			_table_rnd_solve(std, rnd->tmin + 0.5 * step, step, rnd->n - 1, ymid, NULL))
+			goto cleanup;
+
+		rnd->info.evaluations += 6 * rnd->n - 3;
+		prev_error = rnd->info.max_error;
+		rnd->info.max_error = 0;
+
+		for (k = 0; k < rnd->n - 1; k++) {
+			err = fabs(_table_rnd_interp(rnd->y, rnd->m, rnd->n, rnd->tmin, 1.0 / step,
+										 rnd->tmin + (k + 0.5) * step) - ymid[k]);
+			rnd->info.max_error = max(rnd->info.max_error, err);
+		}
+
+		/* Also stop at the error of the quantiles themselves, which a smaller
+		   step does not reduce */
+		if (rnd->info.max_error <= tol || halving == STABLE_TABLE_RND_HALVINGS ||
+			(halving > 0 && rnd->info.max_error > 0.5 * prev_error))
+			break;
+	}
+
+	rnd->info.pieces = rnd->n - 1;
+	rnd->info.memory = 2 * rnd->n * sizeof(double);
+	rnd->built = 1;
+	error = 0;
+
+cleanup:
+	if (rnd != NULL) {
+		benchmark_end(&rnd->info.build_time);
+
+		if (error)
+			_table_free_rnd(rnd);
+	}
+
+	free(ymid);
+	stable_free(std[0]);
+	stable_free(std[1]);
+
+	return error;
+}
+
+short stable_rnd_table_info(const StableDist *dist, struct stable_table_info *info)
+{
+	if (!stable_table_rnd_ready(dist))
+		return -1;
+
+	*info = dist->table->rnd.info;
+
+	return 0;
+}
+
+/* Standard variates of the uniforms u. Values go first to a local buffer,
+   which the compiler knows apart from the table, so that the loads of the
+   nodes are gathered in the vectorized loop */
+static void _table_rnd_map(const struct stable_table_rnd *tab, const double u[],
+						   double x[], int n)
+{
+	const double *y = tab->y, *m = tab->m, tmin = tab->tmin, inv_step = 1.0 / tab->step;
+	double buf[64], e;
+	int i, j, len;
+
+	for (j = 0; j < n; j += len) {
+		len = min(64, n - j);
+
+		for (i = 0; i < len; i++) {
+			e = stable_vm_exp(_table_rnd_interp(y, m, tab->n, tmin, inv_step,
+												stable_vm_log(u[j + i] / (1 - u[j + i]))));
+			buf[i] = 0.5 * (e - 1 / e);
+		}
+
+		memcpy(x + j, buf, len * sizeof(double));
+	}
+}
+
+void stable_rnd_transform_TABLE(const StableDist *dist, const double u[],
+								const double w[], double rnd[], int n)
+{
+	const struct stable_table_rnd *tab = &dist->table->rnd;
+	int i;
+
+	_table_rnd_map(tab, u, rnd, n);
+
+	for (i = 0; i < n; i++)
+		rnd[i] = dist->mu_0 + dist->sigma * rnd[i];
+}